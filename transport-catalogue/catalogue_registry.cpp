@@ -0,0 +1,162 @@
+#include "catalogue_registry.h"
+
+#include <iterator>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "json_builder.h"
+#include "json_reader.h"
+#include "log_duration.h"
+#include "parallel.h"
+
+namespace request {
+
+using namespace std::literals;
+
+CatalogueRegistry::CatalogueRegistry(serialization::TransportBase base, bool prepare_responses) {
+    cities_.emplace(""s, std::make_unique<SnapshotManager>(std::move(base), prepare_responses));
+}
+
+CatalogueRegistry::CatalogueRegistry(const json::Dict& cities, const BaseLoader& load_base,
+                                     bool prepare_responses) {
+    LOG_DURATION("Cities build");
+
+    // Словарь городов заполняется заранее, поэтому потоки пишут каждый в свою запись
+    std::vector<std::pair<const json::Dict*, std::unique_ptr<SnapshotManager>*>> tasks;
+    tasks.reserve(cities.size());
+    for (const auto& [city, description] : cities)
+        tasks.emplace_back(&description.AsDict(), &cities_[city]);
+
+    const size_t thread_count = parallel::GetDefaultThreadCount();
+    parallel::ForEachIndex(tasks.size(), thread_count, [&](size_t index, size_t /* thread_id */) {
+        *tasks[index].second = std::make_unique<SnapshotManager>(load_base(*tasks[index].first), prepare_responses);
+    });
+}
+
+SnapshotManager* CatalogueRegistry::FindCity(std::string_view city) {
+    const auto position = cities_.find(city);
+    return (position != cities_.end()) ? position->second.get() : nullptr;
+}
+
+const SnapshotManager* CatalogueRegistry::FindCity(std::string_view city) const {
+    const auto position = cities_.find(city);
+    return (position != cities_.end()) ? position->second.get() : nullptr;
+}
+
+json::Node CatalogueRegistry::MakeStatResponse(const json::Array& requests) const {
+    std::vector<std::shared_ptr<const CatalogueSnapshot>> request_snapshots;
+    auto responses = MakeResponseList(requests, false, request_snapshots);
+
+    json::Array result;
+    result.reserve(requests.size());
+    for (auto& response : responses)
+        std::move(response.begin(), response.end(), std::back_inserter(result));
+    return json::Node(std::move(result));
+}
+
+void CatalogueRegistry::PrintCompactStatResponse(const json::Array& requests, std::ostream& output) const {
+    std::vector<std::shared_ptr<const CatalogueSnapshot>> request_snapshots;
+    const auto responses = MakeResponseList(requests, true, request_snapshots);
+
+    // Разметка совпадает с json::PrintCompact массива ответов
+    bool is_first = true;
+    const auto start_item = [&output, &is_first] {
+        if (!is_first)
+            output.put(',');
+        is_first = false;
+    };
+
+    output.put('[');
+    for (size_t index = 0; index < requests.size(); ++index) {
+        const auto& request = requests[index].AsDict();
+        if (const auto& snapshot = request_snapshots[index];
+            snapshot && snapshot->GetResponseFragments().Contains(request)) {
+            start_item();
+            snapshot->GetResponseFragments().Write(request, output);
+            continue;
+        }
+        for (const auto& response : responses[index]) {
+            start_item();
+            json::PrintCompact(response, output);
+        }
+    }
+    output.put(']');
+}
+
+std::vector<json::Array> CatalogueRegistry::MakeResponseList(
+    const json::Array& requests, bool use_fragments,
+    std::vector<std::shared_ptr<const CatalogueSnapshot>>& request_snapshots) const {
+    // Шаг 1. Номера запросов по городам в порядке первого упоминания
+    std::map<std::string_view, size_t> city_ids;
+    std::vector<std::string_view> cities;
+    std::vector<std::vector<size_t>> city_requests;
+    for (size_t index = 0; index < requests.size(); ++index) {
+        const auto city = GetRequestCity(requests[index].AsDict());
+        const auto [position, inserted] = city_ids.emplace(city, cities.size());
+        if (inserted) {
+            cities.push_back(city);
+            city_requests.emplace_back();
+        }
+        city_requests[position->second].push_back(index);
+    }
+
+    request_snapshots.assign(requests.size(), nullptr);
+    const auto make_city_responses = [use_fragments](const CatalogueSnapshot& snapshot,
+                                                     const json::Array& city_request_list) {
+        return MakeStatResponseList(snapshot.GetCatalogue(), city_request_list, snapshot.GetVisualization(),
+                                    snapshot.GetRouter(), 0u, [&snapshot] { return snapshot.RenderMap(); },
+                                    use_fragments ? &snapshot.GetResponseFragments() : nullptr);
+    };
+
+    // Все запросы к одному городу - обычный ответ по его каталогу, без копирования запросов
+    if (cities.size() == 1u) {
+        if (const auto* snapshots = FindCity(cities.front())) {
+            request_snapshots.assign(requests.size(), snapshots->Acquire());
+            return make_city_responses(*request_snapshots.front(), requests);
+        }
+    }
+
+    // Шаг 2. Города отвечают параллельно, каждый - на общем пуле
+    std::vector<json::Array> responses(requests.size());
+    const size_t thread_count = parallel::GetDefaultThreadCount();
+    parallel::ForEachIndex(cities.size(), thread_count, [&](size_t city_id, size_t /* thread_id */) {
+        const auto& indexes = city_requests[city_id];
+
+        const auto* snapshots = FindCity(cities[city_id]);
+        if (!snapshots) {
+            for (size_t index : indexes) {
+                responses[index].emplace_back(json::Builder()
+                                                  .StartDict()
+                                                  .Key("request_id"s)
+                                                  .Value(requests[index].AsDict().at("id"s).AsInt())
+                                                  .Key("error_message"s)
+                                                  .Value("not found"s)
+                                                  .EndDict()
+                                                  .Build());
+            }
+            return;
+        }
+
+        json::Array city_request_list;
+        city_request_list.reserve(indexes.size());
+        for (size_t index : indexes)
+            city_request_list.push_back(requests[index]);
+
+        const auto snapshot = snapshots->Acquire();
+        auto city_responses = make_city_responses(*snapshot, city_request_list);
+        for (size_t position = 0; position < indexes.size(); ++position) {
+            responses[indexes[position]] = std::move(city_responses[position]);
+            request_snapshots[indexes[position]] = snapshot;
+        }
+    });
+
+    return responses;
+}
+
+std::string_view GetRequestCity(const json::Dict& request) {
+    const auto city = request.find("city"s);
+    return (city != request.end()) ? std::string_view(city->second.AsString()) : std::string_view();
+}
+
+}  // namespace request
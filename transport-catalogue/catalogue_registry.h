@@ -0,0 +1,62 @@
+#pragma once
+
+/*
+ * Описание: несколько городов в одном процессе.
+ * У каждого города свои каталог, настройки отрисовки и маршрутизатор (версии базы, см. snapshot_manager.h);
+ * пул потоков и память процесса общие. Запрос направляется в город из поля "city".
+ */
+
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+#include "serialization.h"
+#include "snapshot_manager.h"
+
+namespace request {
+
+class CatalogueRegistry {
+public:  // Types
+    // Строит базу города по её описанию
+    using BaseLoader = std::function<serialization::TransportBase(const json::Dict&)>;
+
+public:  // Constructor
+    // Один город без идентификатора: ему адресованы запросы без поля city.
+    // prepare_responses - у каждой версии заранее строятся готовые ответы Bus и Stop (см. SnapshotManager)
+    explicit CatalogueRegistry(serialization::TransportBase base, bool prepare_responses = false);
+
+    // Города из словаря "идентификатор -> описание базы". Базы городов строятся параллельно на общем пуле
+    CatalogueRegistry(const json::Dict& cities, const BaseLoader& load_base, bool prepare_responses = false);
+
+public:  // Methods
+    // nullptr - города нет
+    [[nodiscard]] SnapshotManager* FindCity(std::string_view city);
+    [[nodiscard]] const SnapshotManager* FindCity(std::string_view city) const;
+
+    // Ответы в порядке запросов. Запросы каждого города отвечают по одной его версии;
+    // на запрос в неизвестный город ответом будет "not found"
+    [[nodiscard]] json::Node MakeStatResponse(const json::Array& requests) const;
+
+    // Выводит json::PrintCompact(MakeStatResponse(requests)); ответы Bus и Stop берутся из готовых ответов версий
+    void PrintCompactStatResponse(const json::Array& requests, std::ostream& output) const;
+
+private:  // Methods
+    // Ответы по массиву на запрос и версии, по которым они получены (nullptr - город не найден).
+    // При use_fragments запросы, на которые у версии есть готовые ответы, остаются без ответа
+    [[nodiscard]] std::vector<json::Array> MakeResponseList(
+        const json::Array& requests, bool use_fragments,
+        std::vector<std::shared_ptr<const CatalogueSnapshot>>& request_snapshots) const;
+
+private:  // Fields
+    std::map<std::string, std::unique_ptr<SnapshotManager>, std::less<>> cities_;
+};
+
+// Город запроса: значение поля city или пустая строка
+[[nodiscard]] std::string_view GetRequestCity(const json::Dict& request);
+
+}  // namespace request
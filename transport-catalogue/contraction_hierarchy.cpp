@@ -0,0 +1,517 @@
+#include "contraction_hierarchy.h"
+
+#include <algorithm>
+
+#include "parallel.h"
+
+namespace graph {
+
+namespace {
+
+// Поиск обходного пути прекращается после стольких вершин: тогда короткий путь добавляется "на всякий случай"
+constexpr size_t kWitnessSettleLimit = 500u;
+
+// Для оценки приоритета достаточно приближённого числа коротких путей
+constexpr size_t kPrioritySettleLimit = 20u;
+
+// У вершин с большим числом пар "вход-выход" число коротких путей при оценке считается равным числу пар:
+// такие вершины всё равно сжимаются последними, а точный подсчёт для них дорог
+constexpr int kMaxPriorityWitnessPairs = 400;
+
+// Пакеты меньше этого размера обрабатываются в текущем потоке
+constexpr size_t kMinParallelBatch = 64u;
+
+}  // namespace
+
+/* BUILDER */
+
+class ContractionHierarchy::Builder {
+public:  // Constructor
+    Builder(const CsrGraph& graph, size_t thread_count, ContractionHierarchy& hierarchy);
+
+public:  // Methods
+    void Run();
+
+private:  // Types
+    struct Arc {
+        VertexId vertex{0u};  //> Соседняя вершина
+        uint32_t edge{0u};    //> Ребро иерархии
+    };
+
+    struct Shortcut {
+        VertexId from{0u};
+        VertexId to{0u};
+        double weight{0.};
+        uint32_t first_half{0u};
+        uint32_t second_half{0u};
+    };
+
+    // Состояние поиска обходных путей, своё у каждого потока
+    struct WitnessState {
+        std::vector<double> distance;
+        std::vector<VertexId> touched;
+        std::vector<char> is_target;
+        std::priority_queue<std::pair<double, VertexId>, std::vector<std::pair<double, VertexId>>, std::greater<>>
+            queue;
+    };
+
+private:  // Methods
+    void AddEdge(const HierarchyEdge& edge);
+
+    [[nodiscard]] bool IsRemoved(VertexId vertex) const;
+    [[nodiscard]] bool IsLocalMinimum(VertexId vertex) const;
+
+    // Поиск идёт до max_distance, пока не найдены все targets_count целей или не исчерпан settle_limit
+    void RunWitnessSearch(WitnessState& state, VertexId source, VertexId excluded, double max_distance,
+                          size_t targets_count, size_t settle_limit) const;
+    [[nodiscard]] std::vector<Shortcut> FindShortcuts(VertexId vertex, WitnessState& state,
+                                                      size_t settle_limit = kWitnessSettleLimit) const;
+    [[nodiscard]] int ComputePriority(VertexId vertex, WitnessState& state) const;
+
+    void CompactArcs(std::vector<Arc>& arcs) const;
+
+    // Вызывает func(index, state) для index из [0, count) на всех потоках
+    template <typename Func>
+    void ParallelFor(size_t count, Func func);
+
+private:  // Fields
+    ContractionHierarchy& hierarchy_;
+    size_t vertex_count_{0u};
+
+    std::vector<std::vector<Arc>> out_;
+    std::vector<std::vector<Arc>> in_;
+
+    std::vector<char> contracted_;
+    std::vector<char> in_batch_;
+    std::vector<int> priority_;
+    std::vector<int> deleted_neighbours_;
+
+    std::vector<WitnessState> states_;
+};
+
+ContractionHierarchy::Builder::Builder(const CsrGraph& graph, size_t thread_count, ContractionHierarchy& hierarchy)
+    : hierarchy_(hierarchy),
+      vertex_count_(graph.GetVertexCount()),
+      out_(vertex_count_),
+      in_(vertex_count_),
+      contracted_(vertex_count_, 0),
+      in_batch_(vertex_count_, 0),
+      priority_(vertex_count_, 0),
+      deleted_neighbours_(vertex_count_, 0) {
+    if (thread_count == 0u)
+        thread_count = parallel::GetDefaultThreadCount();
+
+    states_.resize(thread_count);
+    for (auto& state : states_) {
+        state.distance.assign(vertex_count_, DijkstraSearch::kInfinity);
+        state.is_target.assign(vertex_count_, 0);
+    }
+
+    for (EdgeId edge_id = 0; edge_id != graph.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        AddEdge({edge.from, edge.to, edge.weight, edge_id, kNoShortcut, kNoShortcut});
+    }
+}
+
+void ContractionHierarchy::Builder::Run() {
+    std::vector<VertexId> remaining(vertex_count_);
+    for (VertexId vertex = 0; vertex != vertex_count_; ++vertex)
+        remaining[vertex] = vertex;
+
+    ParallelFor(remaining.size(), [&](size_t id, WitnessState& state) {
+        priority_[remaining[id]] = ComputePriority(remaining[id], state);
+    });
+
+    std::vector<Edge> upward_edges;
+    std::vector<Edge> downward_edges;
+
+    while (!remaining.empty()) {
+        // Шаг 1. Независимое множество: вершины с приоритетом меньше, чем у всех несжатых соседей
+        std::vector<VertexId> batch;
+        std::vector<VertexId> rest;
+        for (VertexId vertex : remaining)
+            (IsLocalMinimum(vertex) ? batch : rest).emplace_back(vertex);
+
+        for (VertexId vertex : batch)
+            in_batch_[vertex] = 1;
+
+        // Шаг 2. Короткие пути для всех вершин пакета ищутся параллельно: граф в это время не меняется
+        std::vector<std::vector<Shortcut>> shortcuts(batch.size());
+        ParallelFor(batch.size(), [&](size_t id, WitnessState& state) {
+            shortcuts[id] = FindShortcuts(batch[id], state);
+        });
+
+        // Шаг 3. Сжатие: оставшиеся рёбра вершины ведут вверх по иерархии
+        std::vector<VertexId> neighbours;
+        for (size_t id = 0; id != batch.size(); ++id) {
+            const VertexId vertex = batch[id];
+
+            for (const auto& arc : out_[vertex]) {
+                if (contracted_[arc.vertex])
+                    continue;
+                upward_edges.push_back({vertex, arc.vertex, hierarchy_.edges_[arc.edge].weight});
+                hierarchy_.upward_edges_.emplace_back(arc.edge);
+                neighbours.emplace_back(arc.vertex);
+            }
+            for (const auto& arc : in_[vertex]) {
+                if (contracted_[arc.vertex])
+                    continue;
+                downward_edges.push_back({vertex, arc.vertex, hierarchy_.edges_[arc.edge].weight});
+                hierarchy_.downward_edges_.emplace_back(arc.edge);
+                neighbours.emplace_back(arc.vertex);
+            }
+
+            contracted_[vertex] = 1;
+            in_batch_[vertex] = 0;
+
+            for (const auto& shortcut : shortcuts[id])
+                AddEdge({shortcut.from, shortcut.to, shortcut.weight, DijkstraSearch::kNoEdge, shortcut.first_half,
+                         shortcut.second_half});
+        }
+        remaining = std::move(rest);
+
+        // Шаг 4. Приоритеты меняются только у соседей сжатых вершин
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (VertexId vertex : neighbours) {
+            ++deleted_neighbours_[vertex];
+            CompactArcs(out_[vertex]);
+            CompactArcs(in_[vertex]);
+        }
+
+        ParallelFor(neighbours.size(), [&](size_t id, WitnessState& state) {
+            priority_[neighbours[id]] = ComputePriority(neighbours[id], state);
+        });
+    }
+
+    hierarchy_.upward_ = CsrGraph(vertex_count_, std::move(upward_edges));
+    hierarchy_.downward_ = CsrGraph(vertex_count_, std::move(downward_edges));
+}
+
+void ContractionHierarchy::Builder::AddEdge(const HierarchyEdge& edge) {
+    if (edge.from == edge.to)
+        return;
+
+    auto& edges = hierarchy_.edges_;
+    const auto edge_id = static_cast<uint32_t>(edges.size());
+
+    // Из параллельных рёбер остаётся только самое короткое
+    for (auto& arc : out_[edge.from]) {
+        if (arc.vertex != edge.to)
+            continue;
+        if (edges[arc.edge].weight <= edge.weight)
+            return;
+
+        arc.edge = edge_id;
+        for (auto& back_arc : in_[edge.to]) {
+            if (back_arc.vertex == edge.from) {
+                back_arc.edge = edge_id;
+                break;
+            }
+        }
+        edges.emplace_back(edge);
+        return;
+    }
+
+    out_[edge.from].push_back({edge.to, edge_id});
+    in_[edge.to].push_back({edge.from, edge_id});
+    edges.emplace_back(edge);
+}
+
+bool ContractionHierarchy::Builder::IsRemoved(VertexId vertex) const {
+    return contracted_[vertex] || in_batch_[vertex];
+}
+
+bool ContractionHierarchy::Builder::IsLocalMinimum(VertexId vertex) const {
+    const auto key = std::make_pair(priority_[vertex], vertex);
+
+    auto is_smaller = [&](const std::vector<Arc>& arcs) {
+        return std::all_of(arcs.begin(), arcs.end(), [&](const Arc& arc) {
+            return contracted_[arc.vertex] || key < std::make_pair(priority_[arc.vertex], arc.vertex);
+        });
+    };
+
+    return is_smaller(out_[vertex]) && is_smaller(in_[vertex]);
+}
+
+void ContractionHierarchy::Builder::RunWitnessSearch(WitnessState& state, VertexId source, VertexId excluded,
+                                                     double max_distance, size_t targets_count,
+                                                     size_t settle_limit) const {
+    for (VertexId vertex : state.touched)
+        state.distance[vertex] = DijkstraSearch::kInfinity;
+    state.touched.clear();
+    state.queue = {};
+
+    state.distance[source] = 0.;
+    state.touched.emplace_back(source);
+    state.queue.emplace(0., source);
+
+    size_t settled = 0u;
+    while (!state.queue.empty() && settled < settle_limit) {
+        const auto [distance, vertex] = state.queue.top();
+        state.queue.pop();
+
+        if (distance > state.distance[vertex])
+            continue;
+        if (distance > max_distance)
+            break;
+        ++settled;
+
+        if (state.is_target[vertex] && --targets_count == 0u)
+            break;
+
+        for (const auto& arc : out_[vertex]) {
+            if (arc.vertex == excluded || IsRemoved(arc.vertex))
+                continue;
+
+            const double candidate = distance + hierarchy_.edges_[arc.edge].weight;
+            if (candidate < state.distance[arc.vertex]) {
+                if (state.distance[arc.vertex] == DijkstraSearch::kInfinity)
+                    state.touched.emplace_back(arc.vertex);
+                state.distance[arc.vertex] = candidate;
+                state.queue.emplace(candidate, arc.vertex);
+            }
+        }
+    }
+}
+
+std::vector<ContractionHierarchy::Builder::Shortcut> ContractionHierarchy::Builder::FindShortcuts(
+    VertexId vertex, WitnessState& state, size_t settle_limit) const {
+    std::vector<Shortcut> shortcuts;
+    const auto& edges = hierarchy_.edges_;
+
+    for (const auto& in_arc : in_[vertex]) {
+        if (IsRemoved(in_arc.vertex))
+            continue;
+
+        const double in_weight = edges[in_arc.edge].weight;
+
+        double max_out_weight = -1.;
+        size_t targets_count = 0u;
+        for (const auto& out_arc : out_[vertex]) {
+            if (!IsRemoved(out_arc.vertex) && out_arc.vertex != in_arc.vertex) {
+                max_out_weight = std::max(max_out_weight, edges[out_arc.edge].weight);
+                state.is_target[out_arc.vertex] = 1;
+                ++targets_count;
+            }
+        }
+        if (targets_count == 0u)
+            continue;
+
+        RunWitnessSearch(state, in_arc.vertex, vertex, in_weight + max_out_weight, targets_count, settle_limit);
+
+        // Короткий путь нужен, если обходной путь без вершины длиннее пути через неё
+        for (const auto& out_arc : out_[vertex]) {
+            if (IsRemoved(out_arc.vertex) || out_arc.vertex == in_arc.vertex)
+                continue;
+            state.is_target[out_arc.vertex] = 0;
+
+            const double weight = in_weight + edges[out_arc.edge].weight;
+            if (state.distance[out_arc.vertex] > weight)
+                shortcuts.push_back({in_arc.vertex, out_arc.vertex, weight, in_arc.edge, out_arc.edge});
+        }
+    }
+
+    return shortcuts;
+}
+
+int ContractionHierarchy::Builder::ComputePriority(VertexId vertex, WitnessState& state) const {
+    auto count_alive = [this](const std::vector<Arc>& arcs) {
+        return static_cast<int>(
+            std::count_if(arcs.begin(), arcs.end(), [this](const Arc& arc) { return !IsRemoved(arc.vertex); }));
+    };
+
+    const int in_degree = count_alive(in_[vertex]);
+    const int out_degree = count_alive(out_[vertex]);
+
+    const int shortcuts = (in_degree * out_degree > kMaxPriorityWitnessPairs)
+                              ? in_degree * out_degree
+                              : static_cast<int>(FindShortcuts(vertex, state, kPrioritySettleLimit).size());
+
+    // Разность рёбер (сколько коротких путей появится минус сколько рёбер исчезнет) важнее равномерности
+    return 2 * (shortcuts - in_degree - out_degree) + deleted_neighbours_[vertex];
+}
+
+void ContractionHierarchy::Builder::CompactArcs(std::vector<Arc>& arcs) const {
+    arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [this](const Arc& arc) { return contracted_[arc.vertex]; }),
+               arcs.end());
+}
+
+template <typename Func>
+void ContractionHierarchy::Builder::ParallelFor(size_t count, Func func) {
+    // Мелкие пакеты дешевле обработать в текущем потоке, чем запускать потоки
+    const size_t thread_count = (count < kMinParallelBatch) ? 1u : states_.size();
+    parallel::ForEachIndex(count, thread_count, [&](size_t id, size_t thread_id) { func(id, states_[thread_id]); });
+}
+
+/* CONTRACTION HIERARCHY */
+
+ContractionHierarchy::ContractionHierarchy(const CsrGraph& graph, size_t thread_count) {
+    Builder(graph, thread_count, *this).Run();
+
+    shortcut_count_ = static_cast<size_t>(std::count_if(
+        edges_.begin(), edges_.end(), [](const HierarchyEdge& edge) { return edge.first_half != kNoShortcut; }));
+}
+
+size_t ContractionHierarchy::GetVertexCount() const {
+    return upward_.GetVertexCount();
+}
+
+size_t ContractionHierarchy::GetShortcutCount() const {
+    return shortcut_count_;
+}
+
+const CsrGraph& ContractionHierarchy::GetUpwardGraph() const {
+    return upward_;
+}
+
+const CsrGraph& ContractionHierarchy::GetDownwardGraph() const {
+    return downward_;
+}
+
+void ContractionHierarchy::UnpackUpwardEdge(EdgeId edge_id, std::vector<EdgeId>& path) const {
+    Unpack(upward_edges_.at(edge_id), path);
+}
+
+void ContractionHierarchy::UnpackDownwardEdge(EdgeId edge_id, std::vector<EdgeId>& path) const {
+    Unpack(downward_edges_.at(edge_id), path);
+}
+
+void ContractionHierarchy::Unpack(uint32_t hierarchy_edge, std::vector<EdgeId>& path) const {
+    std::vector<uint32_t> stack{hierarchy_edge};
+
+    while (!stack.empty()) {
+        const auto& edge = edges_[stack.back()];
+        stack.pop_back();
+
+        if (edge.original != DijkstraSearch::kNoEdge) {
+            path.emplace_back(edge.original);
+        } else {
+            // Вторая половина кладётся первой, чтобы первая раскрылась раньше
+            stack.emplace_back(edge.second_half);
+            stack.emplace_back(edge.first_half);
+        }
+    }
+}
+
+/* CONTRACTION HIERARCHY QUERY */
+
+ContractionHierarchyQuery::ContractionHierarchyQuery(const ContractionHierarchy& hierarchy) : hierarchy_(hierarchy) {
+    for (auto* direction : {&forward_, &backward_}) {
+        direction->distance.assign(hierarchy.GetVertexCount(), DijkstraSearch::kInfinity);
+        direction->previous_edge.assign(hierarchy.GetVertexCount(), DijkstraSearch::kNoEdge);
+    }
+    forward_.graph = &hierarchy.GetUpwardGraph();
+    forward_.stall_graph = &hierarchy.GetDownwardGraph();
+    backward_.graph = &hierarchy.GetDownwardGraph();
+    backward_.stall_graph = &hierarchy.GetUpwardGraph();
+}
+
+std::optional<double> ContractionHierarchyQuery::Run(VertexId source, VertexId target) {
+    Reset();
+
+    forward_.distance.at(source) = 0.;
+    forward_.touched.emplace_back(source);
+    forward_.queue.emplace(0., source);
+
+    backward_.distance.at(target) = 0.;
+    backward_.touched.emplace_back(target);
+    backward_.queue.emplace(0., target);
+
+    while (true) {
+        // Направление больше не может улучшить ответ, если его минимальное расстояние не меньше лучшего
+        for (auto* direction : {&forward_, &backward_}) {
+            if (!direction->queue.empty() && direction->queue.top().first >= best_distance_)
+                direction->queue = {};
+        }
+
+        if (forward_.queue.empty() && backward_.queue.empty())
+            break;
+
+        if (backward_.queue.empty() ||
+            (!forward_.queue.empty() && forward_.queue.top().first <= backward_.queue.top().first)) {
+            Step(forward_, backward_);
+        } else {
+            Step(backward_, forward_);
+        }
+    }
+
+    if (!meeting_vertex_)
+        return std::nullopt;
+    return best_distance_;
+}
+
+const ContractionHierarchy& ContractionHierarchyQuery::GetHierarchy() const {
+    return hierarchy_;
+}
+
+std::vector<EdgeId> ContractionHierarchyQuery::BuildPath() const {
+    std::vector<EdgeId> path;
+    if (!meeting_vertex_)
+        return path;
+
+    // Шаг 1. Рёбра от source до точки встречи: собираем с конца и раскрываем в прямом порядке
+    std::vector<EdgeId> upward_path;
+    for (EdgeId edge_id = forward_.previous_edge[*meeting_vertex_]; edge_id != DijkstraSearch::kNoEdge;
+         edge_id = forward_.previous_edge[forward_.graph->GetEdge(edge_id).from])
+        upward_path.emplace_back(edge_id);
+
+    for (auto edge_id = upward_path.rbegin(); edge_id != upward_path.rend(); ++edge_id)
+        hierarchy_.UnpackUpwardEdge(*edge_id, path);
+
+    // Шаг 2. Рёбра от точки встречи до target уже идут в порядке прохождения
+    for (EdgeId edge_id = backward_.previous_edge[*meeting_vertex_]; edge_id != DijkstraSearch::kNoEdge;
+         edge_id = backward_.previous_edge[backward_.graph->GetEdge(edge_id).from])
+        hierarchy_.UnpackDownwardEdge(edge_id, path);
+
+    return path;
+}
+
+void ContractionHierarchyQuery::Reset() {
+    for (auto* direction : {&forward_, &backward_}) {
+        for (VertexId vertex : direction->touched) {
+            direction->distance[vertex] = DijkstraSearch::kInfinity;
+            direction->previous_edge[vertex] = DijkstraSearch::kNoEdge;
+        }
+        direction->touched.clear();
+        direction->queue = {};
+    }
+
+    best_distance_ = DijkstraSearch::kInfinity;
+    meeting_vertex_.reset();
+}
+
+void ContractionHierarchyQuery::Step(Direction& direction, const Direction& opposite) {
+    const auto [distance, vertex] = direction.queue.top();
+    direction.queue.pop();
+
+    if (distance > direction.distance[vertex])
+        return;
+
+    if (const double total = distance + opposite.distance[vertex]; total < best_distance_) {
+        best_distance_ = total;
+        meeting_vertex_ = vertex;
+    }
+
+    // Stall-on-demand: если в вершину короче прийти сверху, путь через неё не кратчайший и дальше не нужен
+    for (EdgeId edge_id : direction.stall_graph->GetIncidentEdges(vertex)) {
+        const auto& edge = direction.stall_graph->GetEdge(edge_id);
+        if (direction.distance[edge.to] + edge.weight < distance)
+            return;
+    }
+
+    for (EdgeId edge_id : direction.graph->GetIncidentEdges(vertex)) {
+        const auto& edge = direction.graph->GetEdge(edge_id);
+        const double candidate = distance + edge.weight;
+
+        if (candidate < direction.distance[edge.to]) {
+            if (direction.distance[edge.to] == DijkstraSearch::kInfinity)
+                direction.touched.emplace_back(edge.to);
+            direction.distance[edge.to] = candidate;
+            direction.previous_edge[edge.to] = edge_id;
+            direction.queue.emplace(candidate, edge.to);
+        }
+    }
+}
+
+}  // namespace graph
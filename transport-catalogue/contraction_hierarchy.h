@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+ * Описание: иерархии сжатия (contraction hierarchies) поверх графа CSR.
+ * Предобработка сжимает вершины по одной, добавляя "короткие пути" (shortcuts) вместо тех путей через
+ * сжатую вершину, у которых нет обходного пути не длиннее. Запрос - двунаправленный поиск только
+ * по рёбрам, ведущим вверх по иерархии, поэтому он просматривает лишь малую часть графа.
+ */
+
+#include <cstddef>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+namespace graph {
+
+class ContractionHierarchy {
+public:  // Constants
+    static constexpr uint32_t kNoShortcut = std::numeric_limits<uint32_t>::max();
+
+public:  // Types
+    // Ребро иерархии: либо исходное ребро графа, либо короткий путь из двух рёбер иерархии
+    struct HierarchyEdge {
+        VertexId from{0u};
+        VertexId to{0u};
+        double weight{0.};
+        EdgeId original{DijkstraSearch::kNoEdge};
+        uint32_t first_half{kNoShortcut};
+        uint32_t second_half{kNoShortcut};
+    };
+
+public:  // Constructor
+    // Порядок сжатия вычисляется параллельно на thread_count потоках; 0 - по числу ядер
+    explicit ContractionHierarchy(const CsrGraph& graph, size_t thread_count = 0u);
+
+public:  // Methods
+    [[nodiscard]] size_t GetVertexCount() const;
+    [[nodiscard]] size_t GetShortcutCount() const;
+
+    // Рёбра вверх по иерархии: upward - в прямом направлении, downward - обратные рёбра для поиска от цели
+    [[nodiscard]] const CsrGraph& GetUpwardGraph() const;
+    [[nodiscard]] const CsrGraph& GetDownwardGraph() const;
+
+    // Раскрывает ребро верхнего/нижнего графа в исходные рёбра в порядке прохождения
+    void UnpackUpwardEdge(EdgeId edge_id, std::vector<EdgeId>& path) const;
+    void UnpackDownwardEdge(EdgeId edge_id, std::vector<EdgeId>& path) const;
+
+private:  // Types
+    class Builder;
+
+private:  // Methods
+    void Unpack(uint32_t hierarchy_edge, std::vector<EdgeId>& path) const;
+
+private:  // Fields
+    std::vector<HierarchyEdge> edges_;
+    size_t shortcut_count_{0u};
+
+    CsrGraph upward_;
+    std::vector<uint32_t> upward_edges_;  //> Ребро верхнего графа -> ребро иерархии
+
+    CsrGraph downward_;
+    std::vector<uint32_t> downward_edges_;  //> Ребро нижнего графа -> ребро иерархии
+};
+
+/*
+ * Двунаправленный поиск по иерархии. Как и DijkstraSearch, переиспользует состояние между запросами:
+ * сбрасываются только затронутые вершины
+ */
+class ContractionHierarchyQuery {
+public:  // Constructor
+    explicit ContractionHierarchyQuery(const ContractionHierarchy& hierarchy);
+
+public:  // Methods
+    // Возвращает длину кратчайшего пути или std::nullopt, если target недостижима
+    std::optional<double> Run(VertexId source, VertexId target);
+
+    [[nodiscard]] const ContractionHierarchy& GetHierarchy() const;
+
+    // Исходные рёбра найденного пути в порядке прохождения
+    [[nodiscard]] std::vector<EdgeId> BuildPath() const;
+
+private:  // Types
+    using QueueItem = std::pair<double, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>;
+
+    struct Direction {
+        const CsrGraph* graph{nullptr};
+        const CsrGraph* stall_graph{nullptr};  //> Рёбра из более высоких вершин в эту, для отсечения
+        std::vector<double> distance;
+        std::vector<EdgeId> previous_edge;
+        std::vector<VertexId> touched;
+        Queue queue;
+    };
+
+private:  // Methods
+    void Reset();
+    void Step(Direction& direction, const Direction& opposite);
+
+private:  // Fields
+    const ContractionHierarchy& hierarchy_;
+
+    Direction forward_;
+    Direction backward_;
+
+    double best_distance_{DijkstraSearch::kInfinity};
+    std::optional<VertexId> meeting_vertex_;
+};
+
+}  // namespace graph
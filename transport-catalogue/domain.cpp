@@ -13,6 +13,8 @@ std::ostream& operator<<(std::ostream& os, const BusStatistics& bus_info) {
 }
 
 size_t Bus::GetStopsCount() const {
+    if (stop_names.empty())
+        return 0u;
     return (type == RouteType::CIRCLE) ? stop_names.size() : 2 * stop_names.size() - 1;
 }
 
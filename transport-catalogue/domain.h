@@ -44,5 +44,32 @@ struct BusStatistics {
     double curvature{0.};
 };
 
+// Поля BusStatistics, по которым построены отсортированные индексы
+enum class BusStatisticsField { ROUTE_LENGTH, CURVATURE, STOPS_COUNT, UNIQUE_STOPS_COUNT };
+
+// Остановка, найденная пространственным поиском, и расстояние до неё в метрах
+struct NearbyStop {
+    std::shared_ptr<Stop> stop;
+    double distance{0.};
+};
+
+// Остановка, найденная нечётким поиском по названию, и похожесть её названия на запрос (от 0 до 1)
+struct SimilarStop {
+    std::shared_ptr<Stop> stop;
+    double similarity{0.};
+};
+
+// Автобус, который без пересадок везёт от одной остановки к другой, и наименьшее число пролётов между ними
+struct BusConnection {
+    std::shared_ptr<Bus> bus;
+    int span_count{0};
+};
+
 std::ostream& operator<<(std::ostream& os, const BusStatistics& statistics);
+// Названия автобусов и остановок, добавленных или изменённых пакетом изменений базы
+struct CatalogueChanges {
+    std::set<std::string> buses;
+    std::set<std::string> stops;
+};
+
 }  // namespace catalogue 
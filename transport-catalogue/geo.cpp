@@ -1,13 +1,16 @@
 #include "geo.h"
 
+#include <algorithm>
+
 namespace geo {
 
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
     static const double dr = 3.1415926535 / 180.;
-    return acos(sin(from.lat * dr) * sin(to.lat * dr) +
-                cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr)) *
-           6371000;
+    // Для совпадающих и очень близких точек погрешность округления может вывести косинус за 1
+    const double cosine = sin(from.lat * dr) * sin(to.lat * dr) +
+                          cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr);
+    return acos(min(1., max(-1., cosine))) * 6371000;
 }
 
 }  // namespace geo 
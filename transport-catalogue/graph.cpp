@@ -0,0 +1,144 @@
+#include "graph.h"
+
+#include <algorithm>
+
+namespace graph {
+
+/* CSR GRAPH */
+
+CsrGraph::CsrGraph(size_t vertex_count, std::vector<Edge> edges)
+    : edges_(std::move(edges)), offsets_(vertex_count + 1, 0u), incidence_(edges_.size()) {
+    // Сортировка подсчётом по начальной вершине
+    for (const auto& edge : edges_)
+        ++offsets_[edge.from + 1];
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+        offsets_[vertex + 1] += offsets_[vertex];
+
+    std::vector<uint32_t> positions(offsets_.begin(), std::prev(offsets_.end()));
+    for (EdgeId edge_id = 0; edge_id != edges_.size(); ++edge_id)
+        incidence_[positions[edges_[edge_id].from]++] = edge_id;
+}
+
+size_t CsrGraph::GetVertexCount() const {
+    return offsets_.empty() ? 0u : offsets_.size() - 1;
+}
+
+size_t CsrGraph::GetEdgeCount() const {
+    return edges_.size();
+}
+
+const Edge& CsrGraph::GetEdge(EdgeId edge_id) const {
+    return edges_.at(edge_id);
+}
+
+CsrGraph::EdgeRange CsrGraph::GetIncidentEdges(VertexId vertex) const {
+    return {incidence_.data() + offsets_.at(vertex), incidence_.data() + offsets_.at(vertex + 1)};
+}
+
+/* DIJKSTRA SEARCH */
+
+DijkstraSearch::DijkstraSearch(const CsrGraph& graph)
+    : graph_(graph),
+      distance_(graph.GetVertexCount(), kInfinity),
+      previous_edge_(graph.GetVertexCount(), kNoEdge) {}
+
+template <typename Predicate>
+void DijkstraSearch::RunUntil(VertexId source, Predicate is_done) {
+    Reset();
+
+    distance_.at(source) = 0.;
+    touched_.emplace_back(source);
+    queue_.emplace(0., source);
+
+    while (!queue_.empty()) {
+        const auto [distance, vertex] = queue_.top();
+        queue_.pop();
+
+        // Устаревшая запись очереди: вершина уже извлечена с меньшим расстоянием
+        if (distance > distance_[vertex])
+            continue;
+
+        settled_.emplace_back(vertex);
+        if (is_done(vertex, distance))
+            break;
+
+        for (EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const double candidate = distance + edge.weight;
+
+            if (candidate < distance_[edge.to]) {
+                if (distance_[edge.to] == kInfinity)
+                    touched_.emplace_back(edge.to);
+                distance_[edge.to] = candidate;
+                previous_edge_[edge.to] = edge_id;
+                queue_.emplace(candidate, edge.to);
+            }
+        }
+    }
+}
+
+void DijkstraSearch::Run(VertexId source, std::optional<VertexId> target, double max_distance) {
+    RunUntil(source, [&](VertexId vertex, double distance) {
+        return distance > max_distance || (target && vertex == *target);
+    });
+
+    // Вершина за пределами max_distance извлечена, но не считается достигнутой окончательно
+    if (!settled_.empty() && distance_[settled_.back()] > max_distance)
+        settled_.pop_back();
+}
+
+void DijkstraSearch::RunToTargets(VertexId source, const std::vector<VertexId>& targets) {
+    if (is_target_.empty())
+        is_target_.assign(graph_.GetVertexCount(), 0);
+
+    size_t targets_left = 0u;
+    for (VertexId target : targets) {
+        if (!is_target_.at(target)) {
+            is_target_[target] = 1;
+            ++targets_left;
+        }
+    }
+
+    RunUntil(source, [&](VertexId vertex, double) { return is_target_[vertex] && --targets_left == 0u; });
+
+    for (VertexId target : targets)
+        is_target_[target] = 0;
+}
+
+const CsrGraph& DijkstraSearch::GetGraph() const {
+    return graph_;
+}
+
+bool DijkstraSearch::IsReached(VertexId vertex) const {
+    return distance_.at(vertex) != kInfinity;
+}
+
+double DijkstraSearch::GetDistance(VertexId vertex) const {
+    return distance_.at(vertex);
+}
+
+std::vector<EdgeId> DijkstraSearch::BuildPath(VertexId target) const {
+    std::vector<EdgeId> path;
+    for (EdgeId edge_id = previous_edge_.at(target); edge_id != kNoEdge;
+         edge_id = previous_edge_[graph_.GetEdge(edge_id).from])
+        path.emplace_back(edge_id);
+
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+const std::vector<VertexId>& DijkstraSearch::GetSettled() const {
+    return settled_;
+}
+
+void DijkstraSearch::Reset() {
+    for (VertexId vertex : touched_) {
+        distance_[vertex] = kInfinity;
+        previous_edge_[vertex] = kNoEdge;
+    }
+    touched_.clear();
+    settled_.clear();
+    queue_ = {};
+}
+
+}  // namespace graph
@@ -0,0 +1,109 @@
+#pragma once
+
+/*
+ * Описание: ориентированный взвешенный граф в компактном формате CSR и поиск кратчайших путей в нём
+ */
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+using VertexId = uint32_t;
+using EdgeId = uint32_t;
+
+struct Edge {
+    VertexId from{0u};
+    VertexId to{0u};
+    double weight{0.};
+};
+
+/*
+ * Рёбра хранятся в порядке добавления (идентификатор ребра - его индекс), а исходящие рёбра каждой вершины
+ * лежат в одном непрерывном массиве: offsets_[v]..offsets_[v + 1] в incidence_
+ */
+class CsrGraph {
+public:  // Types
+    struct EdgeRange {
+        const EdgeId* first{nullptr};
+        const EdgeId* last{nullptr};
+
+        [[nodiscard]] const EdgeId* begin() const {
+            return first;
+        }
+        [[nodiscard]] const EdgeId* end() const {
+            return last;
+        }
+    };
+
+public:  // Constructors
+    CsrGraph() = default;
+    CsrGraph(size_t vertex_count, std::vector<Edge> edges);
+
+public:  // Methods
+    [[nodiscard]] size_t GetVertexCount() const;
+    [[nodiscard]] size_t GetEdgeCount() const;
+
+    [[nodiscard]] const Edge& GetEdge(EdgeId edge_id) const;
+    [[nodiscard]] EdgeRange GetIncidentEdges(VertexId vertex) const;
+
+private:  // Fields
+    std::vector<Edge> edges_;
+    std::vector<uint32_t> offsets_;
+    std::vector<EdgeId> incidence_;
+};
+
+/*
+ * Алгоритм Дейкстры с переиспользуемым состоянием: между запусками сбрасываются только
+ * затронутые вершины, поэтому повторные запросы не платят за размер всего графа
+ */
+class DijkstraSearch {
+public:  // Constants
+    static constexpr double kInfinity = std::numeric_limits<double>::infinity();
+    static constexpr EdgeId kNoEdge = std::numeric_limits<EdgeId>::max();
+
+public:  // Constructor
+    explicit DijkstraSearch(const CsrGraph& graph);
+
+public:  // Methods
+    // Поиск останавливается при извлечении target или когда расстояние превышает max_distance
+    void Run(VertexId source, std::optional<VertexId> target = std::nullopt, double max_distance = kInfinity);
+
+    // Поиск останавливается, когда извлечены все вершины targets (дерево "один ко многим")
+    void RunToTargets(VertexId source, const std::vector<VertexId>& targets);
+
+    [[nodiscard]] const CsrGraph& GetGraph() const;
+    [[nodiscard]] bool IsReached(VertexId vertex) const;
+    [[nodiscard]] double GetDistance(VertexId vertex) const;
+
+    // Рёбра пути от source до target в порядке прохождения
+    [[nodiscard]] std::vector<EdgeId> BuildPath(VertexId target) const;
+
+    // Вершины с окончательно вычисленным расстоянием в порядке его возрастания
+    [[nodiscard]] const std::vector<VertexId>& GetSettled() const;
+
+private:  // Methods
+    void Reset();
+
+    // Общий цикл поиска: is_done(vertex, distance) вызывается для каждой извлечённой вершины
+    template <typename Predicate>
+    void RunUntil(VertexId source, Predicate is_done);
+
+private:  // Fields
+    const CsrGraph& graph_;
+
+    std::vector<double> distance_;
+    std::vector<EdgeId> previous_edge_;
+    std::vector<VertexId> touched_;
+    std::vector<VertexId> settled_;
+    std::vector<char> is_target_;
+
+    using QueueItem = std::pair<double, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue_;
+};
+
+}  // namespace graph
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -75,6 +76,9 @@ public:
 
         return std::get<Array>(*this);
     }
+    Array& AsArray() {
+        return const_cast<Array&>(std::as_const(*this).AsArray());
+    }
 
     bool IsString() const {
         return std::holds_alternative<std::string>(*this);
@@ -99,6 +103,9 @@ public:
 
         return std::get<Dict>(*this);
     }
+    Dict& AsDict() {
+        return const_cast<Dict&>(std::as_const(*this).AsDict());
+    }
 
     bool operator==(const Node& rhs) const {
         return GetValue() == rhs.GetValue();
@@ -144,4 +151,12 @@ Document Load(std::istream& input);
 
 void Print(const Document& doc, std::ostream& output);
 
+// Вывод узла, вложенного в документ на глубину indent пробелов; первая строка выводится без отступа.
+// Так по частям печатается то же, что Print выводит для документа целиком
+void Print(const Node& node, std::ostream& output, int indent);
+
+// Вывод в одну строку без отступов: переводы строк внутри строк экранируются, поэтому подходит для NDJSON
+void PrintCompact(const Document& doc, std::ostream& output);
+void PrintCompact(const Node& node, std::ostream& output);
+
 }  // namespace json
@@ -1,7 +1,17 @@
 #include "json_reader.h"
 #include "json_builder.h"
-
+#include "log_duration.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 
 namespace request {
 
@@ -53,7 +63,8 @@ void MakeBusResponse(int request_id, const BusStatistics& statistics, json::Buil
     response.EndDict();
 }
 
-void MakeStopResponse(int request_id, const std::set<std::string_view>& buses, json::Builder& response) {
+template <typename Buses>
+void MakeStopResponse(int request_id, const Buses& buses, json::Builder& response) {
     response.StartDict();
     response.Key("request_id"s).Value(request_id);
 
@@ -72,6 +83,277 @@ void MakeErrorResponse(int request_id, json::Builder& response) {
     response.EndDict();
 }
 
+void MakeRouteResponse(int request_id, const routing::RouteInfo& route, json::Builder& response) {
+    response.StartDict();
+    response.Key("request_id"s).Value(request_id);
+    response.Key("total_time"s).Value(route.total_time);
+
+    response.Key("items"s).StartArray();
+    for (const auto& item : route.items) {
+        response.StartDict();
+        if (item.type == routing::RouteItemType::Wait) {
+            response.Key("type"s).Value("Wait"s);
+            response.Key("stop_name"s).Value(std::string(item.name));
+        } else {
+            response.Key("type"s).Value("Bus"s);
+            response.Key("bus"s).Value(std::string(item.name));
+            response.Key("span_count"s).Value(item.span_count);
+        }
+        response.Key("time"s).Value(item.time);
+        response.EndDict();
+    }
+    response.EndArray();
+
+    response.EndDict();
+}
+
+void MakeMatrixResponse(int request_id, const routing::TravelTimeMatrix& matrix, json::Builder& response) {
+    response.StartDict();
+    response.Key("request_id"s).Value(request_id);
+
+    response.Key("times"s).StartArray();
+    for (size_t source = 0; source < matrix.sources_count; ++source) {
+        response.StartArray();
+        for (size_t target = 0; target < matrix.targets_count; ++target) {
+            if (const auto& time = matrix.At(source, target)) {
+                response.Value(*time);
+            } else {
+                response.Value(nullptr);
+            }
+        }
+        response.EndArray();
+    }
+    response.EndArray();
+
+    response.EndDict();
+}
+
+void MakeReachableStops(const std::vector<routing::ReachableStop>& stops, json::Builder& response) {
+    response.Key("stops"s).StartArray();
+    for (const auto& stop : stops) {
+        response.StartDict();
+        response.Key("stop_name"s).Value(std::string(stop.stop_name));
+        response.Key("time"s).Value(stop.time);
+        response.EndDict();
+    }
+    response.EndArray();
+}
+
+void MakeIsochroneResponse(int request_id, const std::vector<routing::ReachableStop>& stops,
+                           json::Builder& response) {
+    response.StartDict();
+    response.Key("request_id"s).Value(request_id);
+    MakeReachableStops(stops, response);
+    response.EndDict();
+}
+
+void MakeIsochronesResponse(int request_id, const std::vector<std::string_view>& origins,
+                            const std::vector<std::optional<std::vector<routing::ReachableStop>>>& isochrones,
+                            json::Builder& response) {
+    response.StartDict();
+    response.Key("request_id"s).Value(request_id);
+
+    response.Key("isochrones"s).StartArray();
+    for (size_t id = 0; id < origins.size(); ++id) {
+        response.StartDict();
+        response.Key("from"s).Value(std::string(origins[id]));
+        if (isochrones[id]) {
+            MakeReachableStops(*isochrones[id], response);
+        } else {
+            response.Key("error_message"s).Value("not found"s);
+        }
+        response.EndDict();
+    }
+    response.EndArray();
+
+    response.EndDict();
+}
+
+void MakeNearbyResponse(int request_id, const TransportCatalogue& catalogue, const std::vector<NearbyStop>& stops,
+                        json::Builder& response) {
+    response.StartDict();
+    response.Key("request_id"s).Value(request_id);
+
+    response.Key("stops"s).StartArray();
+    for (const auto& [stop, distance] : stops) {
+        response.StartDict();
+        response.Key("name"s).Value(stop->name);
+        response.Key("distance"s).Value(distance);
+
+        response.Key("buses"s).StartArray();
+        if (auto buses = catalogue.GetBusStop(stop->name)) {
+            for (std::string_view bus : *buses)
+                response.Value(std::string(bus));
+        }
+        response.EndArray();
+
+        response.EndDict();
+    }
+    response.EndArray();
+
+    response.EndDict();
+}
+
+// Ближайшие count остановок, все остановки в радиусе radius или ближайшие count из них
+std::vector<NearbyStop> FindNearbyStops(const TransportCatalogue& catalogue, const json::Dict& request) {
+    const geo::Coordinates center{request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble()};
+    const bool has_count = request.count("count"s) > 0;
+    const bool has_radius = request.count("radius"s) > 0;
+
+    if (!has_count)
+        return catalogue.FindStopsInRadius(center, has_radius ? request.at("radius"s).AsDouble() : 0.);
+
+    auto stops = catalogue.FindNearestStops(center, static_cast<size_t>(std::max(0, request.at("count"s).AsInt())));
+    if (has_radius) {
+        const double radius = request.at("radius"s).AsDouble();
+        stops.erase(std::find_if(stops.begin(), stops.end(),
+                                 [radius](const NearbyStop& stop) { return stop.distance > radius; }),
+                    stops.end());
+    }
+    return stops;
+}
+
+void MakeNames(const std::string& key, const std::vector<std::string_view>& names, json::Builder& response) {
+    response.Key(key).StartArray();
+    for (std::string_view name : names)
+        response.Value(std::string(name));
+    response.EndArray();
+}
+
+// Необязательный "kind" ограничивает поиск остановками ("stops") или автобусами ("buses")
+void MakeAutocompleteResponse(int request_id, const TransportCatalogue& catalogue, const json::Dict& request,
+                              json::Builder& response) {
+    const std::string& prefix = request.at("prefix"s).AsString();
+    const size_t limit = (request.count("limit"s) > 0) ? static_cast<size_t>(std::max(0, request.at("limit"s).AsInt()))
+                                                       : 10u;
+    const std::string kind = (request.count("kind"s) > 0) ? request.at("kind"s).AsString() : ""s;
+
+    response.StartDict();
+    response.Key("request_id"s).Value(request_id);
+    if (kind != "stops"s)
+        MakeNames("buses"s, catalogue.FindBusesByPrefix(prefix, limit), response);
+    if (kind != "buses"s)
+        MakeNames("stops"s, catalogue.FindStopsByPrefix(prefix, limit), response);
+    response.EndDict();
+}
+
+BusStatisticsField ParseBusStatisticsField(const std::string& field) {
+    if (field == "route_length"s)
+        return BusStatisticsField::ROUTE_LENGTH;
+    if (field == "curvature"s)
+        return BusStatisticsField::CURVATURE;
+    if (field == "stop_count"s)
+        return BusStatisticsField::STOPS_COUNT;
+    if (field == "unique_stop_count"s)
+        return BusStatisticsField::UNIQUE_STOPS_COUNT;
+    throw std::invalid_argument("Unknown bus statistics field: "s + field);
+}
+
+// "top" - лучшие автобусы по полю "field", иначе - все автобусы со значением поля в ["min", "max"]
+void MakeBusRankingResponse(int request_id, const TransportCatalogue& catalogue, const json::Dict& request,
+                            json::Builder& response) {
+    const auto field = ParseBusStatisticsField(request.at("field"s).AsString());
+
+    std::vector<BusStatistics> buses;
+    if (request.count("top"s) > 0) {
+        buses = catalogue.GetTopBuses(field, static_cast<size_t>(std::max(0, request.at("top"s).AsInt())));
+    } else {
+        const double min_value = (request.count("min"s) > 0) ? request.at("min"s).AsDouble()
+                                                            : -std::numeric_limits<double>::infinity();
+        const double max_value = (request.count("max"s) > 0) ? request.at("max"s).AsDouble()
+                                                            : std::numeric_limits<double>::infinity();
+        buses = catalogue.GetBusesInRange(field, min_value, max_value);
+    }
+
+    response.StartDict();
+    response.Key("request_id"s).Value(request_id);
+
+    response.Key("buses"s).StartArray();
+    for (const auto& statistics : buses) {
+        response.StartDict();
+        response.Key("bus"s).Value(std::string(statistics.number));
+        response.Key("curvature"s).Value(statistics.curvature);
+        response.Key("route_length"s).Value(statistics.rout_length);
+        response.Key("stop_count"s).Value(static_cast<int>(statistics.stops_count));
+        response.Key("unique_stop_count"s).Value(static_cast<int>(statistics.unique_stops_count));
+        response.EndDict();
+    }
+    response.EndArray();
+
+    response.EndDict();
+}
+
+void MakeConnectionResponse(int request_id, const std::vector<BusConnection>& connections,
+                            json::Builder& response) {
+    response.StartDict();
+    response.Key("request_id"s).Value(request_id);
+
+    response.Key("buses"s).StartArray();
+    for (const auto& [bus, span_count] : connections) {
+        response.StartDict();
+        response.Key("bus"s).Value(bus->number);
+        response.Key("span_count"s).Value(span_count);
+        response.EndDict();
+    }
+    response.EndArray();
+
+    response.EndDict();
+}
+
+// Остановки, похожие на "name": терпит опечатки в названии
+void MakeFuzzyStopResponse(int request_id, const TransportCatalogue& catalogue, const json::Dict& request,
+                           json::Builder& response) {
+    const size_t limit = (request.count("limit"s) > 0) ? static_cast<size_t>(std::max(0, request.at("limit"s).AsInt()))
+                                                       : 10u;
+    const double min_similarity =
+        (request.count("min_similarity"s) > 0) ? request.at("min_similarity"s).AsDouble() : 0.;
+
+    response.StartDict();
+    response.Key("request_id"s).Value(request_id);
+
+    response.Key("stops"s).StartArray();
+    for (const auto& [stop, similarity] :
+         catalogue.FindSimilarStops(request.at("name"s).AsString(), limit, min_similarity)) {
+        response.StartDict();
+        response.Key("stop_name"s).Value(stop->name);
+        response.Key("similarity"s).Value(similarity);
+        response.EndDict();
+    }
+    response.EndArray();
+
+    response.EndDict();
+}
+
+std::vector<std::string_view> ParseStopNames(const json::Array& names) {
+    std::vector<std::string_view> result;
+    result.reserve(names.size());
+
+    for (const auto& name : names)
+        result.emplace_back(name.AsString());
+
+    return result;
+}
+
+// Двоичные данные (PNG) передаются в JSON в кодировке Base64
+std::string EncodeBase64(std::string_view data) {
+    static const char* const kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string result;
+    result.reserve((data.size() + 2) / 3 * 4);
+
+    for (size_t id = 0; id < data.size(); id += 3) {
+        const size_t left = std::min<size_t>(3u, data.size() - id);
+        uint32_t chunk = 0;
+        for (size_t byte = 0; byte < 3; ++byte)
+            chunk = (chunk << 8) | ((byte < left) ? static_cast<uint8_t>(data[id + byte]) : 0u);
+
+        for (size_t symbol = 0; symbol < 4; ++symbol)
+            result.push_back(symbol <= left ? kAlphabet[(chunk >> (18 - 6 * symbol)) & 0x3F] : '=');
+    }
+
+    return result;
+}
+
 void MakeMapImageResponse(int request_id, const std::string& image, json::Builder& response) {
     response.StartDict();
     response.Key("request_id"s).Value(request_id);
@@ -138,8 +420,183 @@ render::UnderLayer ParseLayer(const json::Dict& settings) {
     return layer;
 }
 
-}  // namespace
+// Добавляет в response ответ на один запрос. Запросы неизвестного типа остаются без ответа
+void MakeSingleResponse(const TransportCatalogue& catalogue, const json::Dict& request_dict_view,
+                        const render::Visualization& settings, const routing::TransportRouter& router,
+                        const MapSource& map_source, json::Builder& response) {
+    int request_id = request_dict_view.at("id"s).AsInt();
+    std::string type = request_dict_view.at("type"s).AsString();
+    std::string name;  //> Could be a name of bus or a stop
+
+    if (type == "Bus"s) {
+        name = request_dict_view.at("name"s).AsString();
+
+        if (auto bus_statistics = catalogue.GetBusStatistics(name)) {
+            MakeBusResponse(request_id, *bus_statistics, response);
+        } else {
+            MakeErrorResponse(request_id, response);
+        }
+    } else if (type == "Stop"s) {
+        name = request_dict_view.at("name"s).AsString();
+        if (auto buses = catalogue.GetBusStop(name)) {
+            MakeStopResponse(request_id, *buses, response);
+        } else {
+            MakeErrorResponse(request_id, response);
+        }
+    } else if (type == "Map"s) {
+        // Необязательный формат "png" - растровая карта в Base64, по умолчанию SVG
+        const auto format = request_dict_view.find("format"s);
+        if (format != request_dict_view.end() && format->second == "png"s) {
+            MakeMapImageResponse(request_id, EncodeBase64(RenderTransportMapPng(catalogue, settings)), response);
+        } else {
+            std::string image = map_source ? map_source() : RenderTransportMap(catalogue, settings);
+            MakeMapImageResponse(request_id, image, response);
+        }
+    } else if (type == "Route"s) {
+        const auto& stop_from = request_dict_view.at("from"s).AsString();
+        const auto& stop_to = request_dict_view.at("to"s).AsString();
+
+        if (auto route = router.BuildRoute(stop_from, stop_to)) {
+            MakeRouteResponse(request_id, *route, response);
+        } else {
+            MakeErrorResponse(request_id, response);
+        }
+    } else if (type == "Matrix"s) {
+        const auto sources = ParseStopNames(request_dict_view.at("sources"s).AsArray());
+        const auto targets = ParseStopNames(request_dict_view.at("targets"s).AsArray());
+
+        MakeMatrixResponse(request_id, router.BuildTravelTimeMatrix(sources, targets), response);
+    } else if (type == "Autocomplete"s) {
+        MakeAutocompleteResponse(request_id, catalogue, request_dict_view, response);
+    } else if (type == "BusRanking"s) {
+        MakeBusRankingResponse(request_id, catalogue, request_dict_view, response);
+    } else if (type == "Connection"s) {
+        if (auto connections = catalogue.FindConnections(request_dict_view.at("from"s).AsString(),
+                                                         request_dict_view.at("to"s).AsString())) {
+            MakeConnectionResponse(request_id, *connections, response);
+        } else {
+            MakeErrorResponse(request_id, response);
+        }
+    } else if (type == "FuzzyStop"s) {
+        MakeFuzzyStopResponse(request_id, catalogue, request_dict_view, response);
+    } else if (type == "Nearby"s) {
+        MakeNearbyResponse(request_id, catalogue, FindNearbyStops(catalogue, request_dict_view), response);
+    } else if (type == "Isochrone"s) {
+        const double time_budget = request_dict_view.at("time_budget"s).AsDouble();
+
+        // Несколько начальных остановок ("origins") обрабатываются параллельно
+        if (request_dict_view.count("origins"s) > 0) {
+            const auto origins = ParseStopNames(request_dict_view.at("origins"s).AsArray());
+            MakeIsochronesResponse(request_id, origins, router.FindReachableStops(origins, time_budget), response);
+        } else if (auto stops = router.FindReachableStops(request_dict_view.at("from"s).AsString(), time_budget)) {
+            MakeIsochroneResponse(request_id, *stops, response);
+        } else {
+            MakeErrorResponse(request_id, response);
+        }
+    }
+}
+
+// Ключ запроса, ответ на который зависит только от его полей, кроме id; std::nullopt - запрос не кэшируется
+std::optional<std::string> MakeDeduplicationKey(const json::Dict& request) {
+    const auto& type = request.at("type"s).AsString();
+
+    // Разделитель '\0' не встречается в названиях
+    if (type == "Bus"s || type == "Stop"s)
+        return type + '\0' + request.at("name"s).AsString();
+    if (type == "Route"s)
+        return type + '\0' + request.at("from"s).AsString() + '\0' + request.at("to"s).AsString();
+    if (type == "Map"s) {
+        const auto format = request.find("format"s);
+        return type + '\0' + ((format != request.end()) ? format->second.AsString() : ""s);
+    }
+    return std::nullopt;
+}
+
+// Запросы Bus и Stop: ответ зависит только от названия и определяется каталогом
+bool IsCatalogueLookupRequest(const json::Dict& request) {
+    const auto& type = request.at("type"s).AsString();
+    return type == "Bus"s || type == "Stop"s;
+}
+
+// Ответы в порядке запросов, по массиву на запрос: запрос неизвестного типа и запрос, для которого skip
+// возвращает true, остаются без ответа
+template <typename Skip>
+std::vector<json::Array> MakeResponseList(const TransportCatalogue& catalogue, const json::Array& requests,
+                                          const render::Visualization& settings,
+                                          const routing::TransportRouter& router, size_t thread_count,
+                                          const MapSource& map_source, Skip skip) {
+    if (thread_count == 0u)
+        thread_count = parallel::GetDefaultThreadCount();
+
+    // Шаг 1. Планирование: одинаковые запросы считаются один раз, остальные копируют ответ первого из них
+    std::vector<size_t> sources(requests.size());
+    std::vector<size_t> distinct;
+    distinct.reserve(requests.size());
+    size_t planned_count = 0u;
+    {
+        std::unordered_map<std::string, size_t> first_requests;
+        for (size_t index = 0; index < requests.size(); ++index) {
+            sources[index] = index;
+            if (skip(requests[index].AsDict()))
+                continue;
+
+            ++planned_count;
+            if (auto key = MakeDeduplicationKey(requests[index].AsDict())) {
+                const auto [position, inserted] = first_requests.emplace(std::move(*key), index);
+                sources[index] = position->second;
+                if (!inserted)
+                    continue;
+            }
+            distinct.push_back(index);
+        }
+    }
+    LOG_HIT_RATE("Stat requests deduplication"s, planned_count - distinct.size(), planned_count);
+
+    // Шаг 2. Ответы на различные запросы. Каждый ответ строится в собственном узле, поэтому запросы можно
+    // обрабатывать параллельно: ответы собираются в исходном порядке, и вывод не зависит от числа потоков
+    std::vector<json::Array> responses(requests.size());
+    std::vector<std::exception_ptr> errors(requests.size());
+    parallel::ForEachIndex(distinct.size(), thread_count, [&](size_t distinct_index, size_t /* thread_id */) {
+        const size_t index = distinct[distinct_index];
+        try {
+            auto response = json::Builder();
+            response.StartArray();
+            MakeSingleResponse(catalogue, requests[index].AsDict(), settings, router, map_source, response);
+            response.EndArray();
+            responses[index] = std::move(response.Build().AsArray());
+        } catch (...) {
+            errors[index] = std::current_exception();
+        }
+    });
 
+    // Ошибка первого по порядку запроса - та же, что и при последовательной обработке
+    for (const auto& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // Шаг 3. Повторные запросы получают копию ответа с собственным request_id
+    for (size_t index = 0; index < requests.size(); ++index) {
+        if (sources[index] == index)
+            continue;
+        responses[index] = responses[sources[index]];
+        for (auto& response : responses[index])
+            response.AsDict().at("request_id"s) = requests[index].AsDict().at("id"s).AsInt();
+    }
+    return responses;
+}
+
+// Текст ответа в том виде, в каком его выводит json::Print элементом массива ответов
+std::string PrintResponseItem(json::Builder& response, bool is_compact) {
+    std::ostringstream output;
+    if (is_compact)
+        json::PrintCompact(response.Build(), output);
+    else
+        json::Print(response.Build(), output, 4);
+    return std::move(output).str();
+}
+
+}  // namespace
 
 //====================================================================================================
     
@@ -183,9 +640,85 @@ TransportCatalogue ProcessBaseRequest(const json::Array& requests) {
         catalogue.AddBus(InputBusRoute(request_dict_view));
     }
 
+    // Шаг 4. Все данные загружены: строим индексы для поисковых запросов
+    catalogue.Freeze();
+
     return catalogue;
 }
 
+CatalogueChanges ApplyDeltaRequests(TransportCatalogue& catalogue, const json::Array& requests) {
+    CatalogueChanges changes;
+    const auto check_stop = [&catalogue](std::string_view stop_name) {
+        if (!catalogue.GetStop(stop_name))
+            throw std::invalid_argument("Unknown stop: "s + std::string(stop_name));
+    };
+
+    // Шаги те же, что и при загрузке базы: остановки, расстояния, маршруты; удаление остановок - последним,
+    // чтобы изменённые маршруты успели с них уйти
+    for (const auto& request : requests) {
+        const auto& request_dict_view = request.AsDict();
+        if (request_dict_view.at("type"s) != "Stop"s)
+            continue;
+
+        auto [stop, _] = InputBusStop(request_dict_view);
+        if (catalogue.GetStop(stop.name))
+            throw std::invalid_argument("Stop already exists: "s + stop.name);
+        changes.stops.insert(stop.name);
+        catalogue.AddStop(std::move(stop));
+    }
+
+    for (const auto& request : requests) {
+        const auto& request_dict_view = request.AsDict();
+        const auto& type = request_dict_view.at("type"s).AsString();
+
+        if (type == "Stop"s) {
+            const auto& stop_from = request_dict_view.at("name"s).AsString();
+            for (const auto& [stop_to, distance] : request_dict_view.at("road_distances"s).AsDict()) {
+                check_stop(stop_to);
+                catalogue.AddDistance(stop_from, stop_to, distance.AsInt());
+            }
+        } else if (type == "Distance"s) {
+            const auto& stop_from = request_dict_view.at("from"s).AsString();
+            const auto& stop_to = request_dict_view.at("to"s).AsString();
+            check_stop(stop_from);
+            check_stop(stop_to);
+            catalogue.AddDistance(stop_from, stop_to, request_dict_view.at("distance"s).AsInt());
+        }
+    }
+
+    for (const auto& request : requests) {
+        const auto& request_dict_view = request.AsDict();
+        const auto& type = request_dict_view.at("type"s).AsString();
+
+        if (type == "Bus"s) {
+            auto bus = InputBusRoute(request_dict_view);
+            for (std::string_view stop : bus.stop_names)
+                check_stop(stop);
+            changes.buses.insert(bus.number);
+            catalogue.AddBus(std::move(bus));
+        } else if (type == "RemoveBus"s) {
+            const auto& bus_name = request_dict_view.at("name"s).AsString();
+            if (!catalogue.RemoveBus(bus_name))
+                throw std::invalid_argument("Unknown bus: "s + bus_name);
+            changes.buses.insert(bus_name);
+        }
+    }
+
+    for (const auto& request : requests) {
+        const auto& request_dict_view = request.AsDict();
+        if (request_dict_view.at("type"s) != "RemoveStop"s)
+            continue;
+
+        const auto& stop_name = request_dict_view.at("name"s).AsString();
+        if (!catalogue.RemoveStop(stop_name))
+            throw std::invalid_argument("Unknown stop: "s + stop_name);
+        changes.stops.insert(stop_name);
+    }
+
+    catalogue.Freeze();
+    return changes;
+}
+
 render::Visualization ParseVisualizationSettings(const json::Dict& settings) {
     render::Visualization final_settings;
 
@@ -207,39 +740,222 @@ render::Visualization ParseVisualizationSettings(const json::Dict& settings) {
         .SetUnderLayer(ParseLayer(settings))
         .SetColors(std::move(svg_colors));
 
+    // Необязательная настройка: допуск упрощения линий маршрутов в пикселях
+    if (settings.count("route_simplification_tolerance"s) > 0)
+        final_settings.SetRouteSimplification(settings.at("route_simplification_tolerance"s).AsDouble());
+
+    // Необязательная настройка: вывод общих стилей карты через CSS-классы
+    if (settings.count("use_style_classes"s) > 0)
+        final_settings.SetStyleClasses(settings.at("use_style_classes"s).AsBool());
+
     return final_settings;
 }
 
+routing::RoutingSettings ParseRoutingSettings(const json::Dict& settings) {
+    routing::RoutingSettings routing_settings;
+
+    routing_settings.bus_wait_time = settings.at("bus_wait_time"s).AsDouble();
+    routing_settings.bus_velocity = settings.at("bus_velocity"s).AsDouble();
+
+    // Необязательная настройка: предобработка графа маршрутов иерархиями сжатия
+    if (settings.count("use_contraction_hierarchies"s) > 0)
+        routing_settings.use_contraction_hierarchies = settings.at("use_contraction_hierarchies"s).AsBool();
+
+    return routing_settings;
+}
+
+serialization::SerializationSettings ParseSerializationSettings(const json::Dict& settings) {
+    serialization::SerializationSettings serialization_settings;
+    serialization_settings.file = settings.at("file"s).AsString();
+
+    // Необязательный образ каталога для отображения в память
+    if (settings.count("image"s) > 0)
+        serialization_settings.image = settings.at("image"s).AsString();
+    return serialization_settings;
+}
+
+ExecutionSettings ParseExecutionSettings(const json::Dict& settings) {
+    ExecutionSettings execution_settings;
+    if (settings.count("thread_count"s) > 0)
+        execution_settings.thread_count = static_cast<size_t>(std::max(0, settings.at("thread_count"s).AsInt()));
+
+    // Необязательная настройка: готовые ответы Bus и Stop строятся один раз после загрузки базы
+    if (settings.count("pre_serialize_responses"s) > 0)
+        execution_settings.pre_serialize_responses = settings.at("pre_serialize_responses"s).AsBool();
+    return execution_settings;
+}
+
 json::Node MakeStatResponse(const TransportCatalogue& catalogue, const json::Array& requests,
-                            const render::Visualization& settings) {
+                            const render::Visualization& settings, const routing::TransportRouter& router,
+                            size_t thread_count, const MapSource& map_source) {
+    auto responses = MakeStatResponseList(catalogue, requests, settings, router, thread_count, map_source);
+
+    json::Array result;
+    result.reserve(requests.size());
+    for (auto& response : responses)
+        std::move(response.begin(), response.end(), std::back_inserter(result));
+    return json::Node(std::move(result));
+}
+
+ResponseFragments::ResponseFragments(const TransportCatalogue& catalogue, bool is_compact)
+    : is_compact_(is_compact) {
+    // Ответы строятся с request_id = 0 и печатаются параллельно; в буфер они собираются по порядку.
+    // Пустой текст - автобус, статистику которого не удалось посчитать
+    const std::vector<std::string_view> bus_names(catalogue.GetOrderedBusList().begin(),
+                                                  catalogue.GetOrderedBusList().end());
+    const auto& stops = catalogue.GetSortedStops();
+
+    std::vector<std::string> texts(bus_names.size() + stops.size() + 1u);
+    const size_t thread_count = parallel::GetDefaultThreadCount();
+    parallel::ForEachIndex(texts.size(), thread_count, [&](size_t index, size_t /* thread_id */) {
+        auto response = json::Builder();
+        if (index < bus_names.size()) {
+            try {
+                MakeBusResponse(0, *catalogue.GetBusStatistics(bus_names[index]), response);
+            } catch (const std::out_of_range&) {
+                return;
+            }
+        } else if (index == texts.size() - 1u) {
+            MakeErrorResponse(0, response);
+        } else if (auto buses = catalogue.GetBusStop(stops[index - bus_names.size()]->name)) {
+            MakeStopResponse(0, *buses, response);
+        } else {
+            MakeErrorResponse(0, response);
+        }
+        texts[index] = PrintResponseItem(response, is_compact_);
+    });
+
+    size_t arena_size = 0u;
+    for (const auto& text : texts)
+        arena_size += text.size();
+    arena_.reserve(arena_size);
+
+    bus_fragments_.reserve(bus_names.size());
+    stop_fragments_.reserve(stops.size());
+    for (size_t index = 0; index < bus_names.size(); ++index) {
+        if (texts[index].empty())
+            skipped_buses_.insert(bus_names[index]);
+        else
+            bus_fragments_.emplace(bus_names[index], AddFragment(texts[index]));
+    }
+    for (size_t index = 0; index < stops.size(); ++index)
+        stop_fragments_.emplace(stops[index]->name, AddFragment(texts[bus_names.size() + index]));
+    not_found_fragment_ = AddFragment(texts.back());
+}
+
+bool ResponseFragments::Contains(const json::Dict& request) const {
+    if (!IsCatalogueLookupRequest(request))
+        return false;
+    return request.at("type"s).AsString() != "Bus"s || skipped_buses_.count(request.at("name"s).AsString()) == 0;
+}
+
+void ResponseFragments::Write(const json::Dict& request, std::ostream& output) const {
+    const auto& fragments = (request.at("type"s).AsString() == "Bus"s) ? bus_fragments_ : stop_fragments_;
+    const auto position = fragments.find(request.at("name"s).AsString());
+    WriteFragment((position != fragments.end()) ? position->second : not_found_fragment_,
+                  request.at("id"s).AsInt(), output);
+}
+
+ResponseFragments::Fragment ResponseFragments::AddFragment(std::string_view text) {
+    // Ключ "request_id" не может встретиться внутри строк: кавычки в них экранируются
+    const std::string_view request_id_key = is_compact_ ? "\"request_id\":"sv : "\"request_id\": "sv;
+    const size_t prefix_length = text.find(request_id_key) + request_id_key.size();
+    const size_t suffix_offset = prefix_length + 1u;  //> Пропускаем значение 0
+
+    Fragment fragment{arena_.size(), static_cast<uint32_t>(prefix_length),
+                      static_cast<uint32_t>(text.size() - suffix_offset)};
+    arena_.append(text.substr(0, prefix_length));
+    arena_.append(text.substr(suffix_offset));
+    return fragment;
+}
+
+void ResponseFragments::WriteFragment(const Fragment& fragment, int request_id, std::ostream& output) const {
+    output.write(arena_.data() + fragment.offset, fragment.prefix_length);
+    output << request_id;
+    output.write(arena_.data() + fragment.offset + fragment.prefix_length, fragment.suffix_length);
+}
+
+std::vector<json::Array> MakeStatResponseList(const TransportCatalogue& catalogue, const json::Array& requests,
+                                              const render::Visualization& settings,
+                                              const routing::TransportRouter& router, size_t thread_count,
+                                              const MapSource& map_source, const ResponseFragments* fragments) {
+    return MakeResponseList(catalogue, requests, settings, router, thread_count, map_source,
+                            [fragments](const json::Dict& request) {
+                                return fragments != nullptr && fragments->Contains(request);
+                            });
+}
+
+bool IsResponseFragmentsWorthBuilding(const TransportCatalogue& catalogue, const json::Array& requests) {
+    const auto lookup_count =
+        static_cast<size_t>(std::count_if(requests.begin(), requests.end(), [](const json::Node& request) {
+            return IsCatalogueLookupRequest(request.AsDict());
+        }));
+    return lookup_count >= catalogue.GetOrderedBusList().size() + catalogue.GetSortedStops().size();
+}
+
+void PrintStatResponse(const TransportCatalogue& catalogue, const json::Array& requests,
+                       const render::Visualization& settings, const routing::TransportRouter& router,
+                       const ResponseFragments* fragments, std::ostream& output) {
+    if (fragments == nullptr) {
+        json::Print(json::Document(MakeStatResponse(catalogue, requests, settings, router)), output);
+        return;
+    }
+
+    // Остальные запросы обрабатываются как обычно, а их ответы печатаются между готовыми фрагментами
+    const auto responses = MakeStatResponseList(catalogue, requests, settings, router, 0u, MapSource(), fragments);
+
+    // Разметка совпадает с json::Print массива ответов
+    bool is_first = true;
+    const auto start_item = [&output, &is_first] {
+        output << (is_first ? "\n    "sv : ",\n    "sv);
+        is_first = false;
+    };
+
+    output.put('[');
+    for (size_t index = 0; index < requests.size(); ++index) {
+        const auto& request = requests[index].AsDict();
+        if (fragments->Contains(request)) {
+            start_item();
+            fragments->Write(request, output);
+            continue;
+        }
+        for (const auto& response : responses[index]) {
+            start_item();
+            json::Print(response, output, 4);
+        }
+    }
+    output << (is_first ? "\n\n]"sv : "\n]"sv);
+}
+
+bool IsMappedCatalogueRequests(const json::Array& requests) {
+    return std::all_of(requests.begin(), requests.end(), [](const json::Node& request) {
+        return IsCatalogueLookupRequest(request.AsDict());
+    });
+}
+
+json::Node MakeStatResponse(const serialization::MappedCatalogue& catalogue, const json::Array& requests) {
     auto response = json::Builder();
     response.StartArray();
 
     for (const auto& request : requests) {
         const auto& request_dict_view = request.AsDict();
 
-        int request_id = request_dict_view.at("id"s).AsInt();
-        std::string type = request_dict_view.at("type"s).AsString();
-        std::string name;  //> Could be a name of bus or a stop
+        const int request_id = request_dict_view.at("id"s).AsInt();
+        const std::string& type = request_dict_view.at("type"s).AsString();
+        const std::string& name = request_dict_view.at("name"s).AsString();
 
         if (type == "Bus"s) {
-            name = request_dict_view.at("name"s).AsString();
-
             if (auto bus_statistics = catalogue.GetBusStatistics(name)) {
                 MakeBusResponse(request_id, *bus_statistics, response);
             } else {
                 MakeErrorResponse(request_id, response);
             }
         } else if (type == "Stop"s) {
-            name = request_dict_view.at("name"s).AsString();
             if (auto buses = catalogue.GetBusStop(name)) {
                 MakeStopResponse(request_id, *buses, response);
             } else {
                 MakeErrorResponse(request_id, response);
             }
-        } else if (type == "Map"s) {
-            std::string image = RenderTransportMap(catalogue, settings);
-            MakeMapImageResponse(request_id, image, response);
         }
     }
 
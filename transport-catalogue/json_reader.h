@@ -5,20 +5,118 @@
  * ответов JSON
  */
 
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "json.h"
 #include "map_renderer.h"
+#include "mapped_catalogue.h"
+#include "serialization.h"
 #include "transport_catalogue.h"
+#include "transport_router.h"
 
 #include "domain.h"
 
 namespace request {
 
 catalogue::TransportCatalogue ProcessBaseRequest(const json::Array& requests);
+
+// Изменения базы: новые остановки ("Stop"), расстояния ("Distance": from, to, distance), новые и изменённые
+// маршруты ("Bus"), удаление автобусов ("RemoveBus") и остановок ("RemoveStop"). После изменений каталог
+// замораживается заново, статистика пересчитывается только для затронутых автобусов.
+// Бросает std::invalid_argument, если запрос ссылается на неизвестный объект.
+// Возвращает затронутые автобусы и остановки: по ним перерисовывается карта
+catalogue::CatalogueChanges ApplyDeltaRequests(catalogue::TransportCatalogue& catalogue, const json::Array& requests);
     
 render::Visualization ParseVisualizationSettings(const json::Dict& settings);
+
+routing::RoutingSettings ParseRoutingSettings(const json::Dict& settings);
+
+serialization::SerializationSettings ParseSerializationSettings(const json::Dict& settings);
+
+struct ExecutionSettings {
+    size_t thread_count{0u};               //> Потоков общего пула: 0 - по числу ядер, 1 - детерминированный режим
+    bool pre_serialize_responses{false};  //> Ответы Bus и Stop сериализуются один раз после загрузки базы
+};
+
+ExecutionSettings ParseExecutionSettings(const json::Dict& settings);
+
+/*
+ * Готовые ответы на запросы Bus и Stop для всех автобусов и остановок замороженного каталога.
+ * Каталог после загрузки не меняется, поэтому тело каждого ответа сериализуется один раз в общий буфер;
+ * при выводе в него подставляется только request_id. Вывод совпадает с json::Print ответа в массиве ответов.
+ */
+class ResponseFragments {
+public:  // Constructor
+    // Каталог должен пережить объект: ключами служат названия из каталога.
+    // is_compact - ответы в виде json::PrintCompact, для сервера запросов
+    explicit ResponseFragments(const catalogue::TransportCatalogue& catalogue, bool is_compact = false);
+
+public:  // Methods
+    // Есть ли готовый ответ на запрос. Нет - для запросов других типов и для автобусов,
+    // статистику которых не удалось посчитать при заморозке: на них отвечают как обычно
+    [[nodiscard]] bool Contains(const json::Dict& request) const;
+
+    // Выводит готовый ответ на запрос. Ответ с отступами выводится с отступом элемента массива ответов,
+    // кроме первой строки
+    void Write(const json::Dict& request, std::ostream& output) const;
+
+private:  // Types
+    // Ответ - это prefix, request_id и suffix; в буфере prefix и suffix записаны подряд
+    struct Fragment {
+        size_t offset{0u};
+        uint32_t prefix_length{0u};
+        uint32_t suffix_length{0u};
+    };
+
+private:  // Methods
+    Fragment AddFragment(std::string_view text);
+    void WriteFragment(const Fragment& fragment, int request_id, std::ostream& output) const;
+
+private:  // Fields
+    std::string arena_;
+    std::unordered_map<std::string_view, Fragment> bus_fragments_;
+    std::unordered_map<std::string_view, Fragment> stop_fragments_;
+    std::unordered_set<std::string_view> skipped_buses_;
+    Fragment not_found_fragment_;
+    bool is_compact_{false};
+};
+
+// Окупается ли построение ResponseFragments для одного пакета: запросов Bus и Stop должно быть
+// не меньше, чем автобусов и остановок в каталоге
+[[nodiscard]] bool IsResponseFragmentsWorthBuilding(const catalogue::TransportCatalogue& catalogue,
+                                                    const json::Array& requests);
     
+// Источник SVG-карты для запросов Map. Пустой - карта рисуется заново по каталогу и настройкам
+using MapSource = std::function<std::string()>;
+
+// Запросы обрабатываются параллельно на thread_count потоках (0 - по числу ядер); порядок и вид ответов
+// не зависят от числа потоков
 json::Node MakeStatResponse(const catalogue::TransportCatalogue& catalogue, const json::Array& requests,
-                            const render::Visualization& settings);
+                            const render::Visualization& settings, const routing::TransportRouter& router,
+                            size_t thread_count = 0u, const MapSource& map_source = {});
+
+// Ответы по массиву на запрос, в порядке запросов (массив запроса неизвестного типа пуст).
+// Запросы, ответы на которые есть в fragments, тоже остаются без ответа
+std::vector<json::Array> MakeStatResponseList(const catalogue::TransportCatalogue& catalogue,
+                                              const json::Array& requests, const render::Visualization& settings,
+                                              const routing::TransportRouter& router, size_t thread_count = 0u,
+                                              const MapSource& map_source = {},
+                                              const ResponseFragments* fragments = nullptr);
+
+// Выводит то же, что json::Print(MakeStatResponse(...)); при заданных fragments ответы Bus и Stop берутся из них
+void PrintStatResponse(const catalogue::TransportCatalogue& catalogue, const json::Array& requests,
+                       const render::Visualization& settings, const routing::TransportRouter& router,
+                       const ResponseFragments* fragments, std::ostream& output);
+
+// Запросы Bus и Stop, на которые можно ответить по образу каталога без загрузки базы
+[[nodiscard]] bool IsMappedCatalogueRequests(const json::Array& requests);
+json::Node MakeStatResponse(const serialization::MappedCatalogue& catalogue, const json::Array& requests);
        
 
 }  // namespace request
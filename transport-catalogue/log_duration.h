@@ -0,0 +1,48 @@
+#pragma once
+
+/*
+ * Описание: замер времени выполнения блока кода и доли попаданий кэшей.
+ * Макросы LOG_DURATION и LOG_HIT_RATE выводят данные в std::cerr, только если проект собран
+ * с TRANSPORT_CATALOGUE_PROFILE, иначе они ничего не делают.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#define PROFILE_CONCAT_INTERNAL(X, Y) X##Y
+#define PROFILE_CONCAT(X, Y) PROFILE_CONCAT_INTERNAL(X, Y)
+#define UNIQUE_VAR_NAME_PROFILE PROFILE_CONCAT(profile_guard_, __LINE__)
+
+#ifdef TRANSPORT_CATALOGUE_PROFILE
+#define LOG_DURATION(name) LogDuration UNIQUE_VAR_NAME_PROFILE(name)
+#define LOG_HIT_RATE(name, hits, total) LogHitRate(name, hits, total)
+#else
+#define LOG_DURATION(name)
+#define LOG_HIT_RATE(name, hits, total)
+#endif
+
+class LogDuration {
+public:  // Types
+    using Clock = std::chrono::steady_clock;
+
+public:  // Constructor
+    explicit LogDuration(std::string name, std::ostream& out = std::cerr) : name_(std::move(name)), out_(out) {}
+
+public:  // Destructor
+    ~LogDuration() {
+        using namespace std::chrono;
+        const auto duration = Clock::now() - start_time_;
+        out_ << name_ << ": " << duration_cast<microseconds>(duration).count() << " us" << std::endl;
+    }
+
+private:  // Fields
+    const std::string name_;
+    std::ostream& out_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+inline void LogHitRate(const std::string& name, size_t hits, size_t total, std::ostream& out = std::cerr) {
+    const double rate = (total > 0u) ? 100. * static_cast<double>(hits) / static_cast<double>(total) : 0.;
+    out << name << ": " << hits << " hits of " << total << " (" << rate << "%)" << std::endl;
+}
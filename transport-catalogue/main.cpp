@@ -11,34 +11,44 @@ using namespace std;
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <string_view>
 
 using namespace std;
 using namespace catalogue;
 
-int main() {
-        // Раскомментируйте эту строку, чтобы вызвать функцию ProcessTransportCatalogueQuery
-   // request::ProcessTransportCatalogueQuery(std::cin, std::cout);
-
-  // Чтение входного JSON-документа
-    json::Document doc = json::Load(std::cin);
-    const auto& input_json = doc.GetRoot().AsDict();
-
-    // Шаг 1. Формирование каталога на основе входных данных с помощью метода из json_reader.cpp
-    const auto& base_requests = input_json.at("base_requests").AsArray();
-    TransportCatalogue transport_catalogue = request::ProcessBaseRequest(base_requests);
-
-    // Шаг 2. Разбор настроек отображения с помощью метода из json_reader.cpp
-    const auto& render_settings = input_json.at("render_settings").AsDict();
-    render::Visualization visualization_settings = request::ParseVisualizationSettings(render_settings);
-
-    // Шаг 3. Формирование ответа на основе каталога и запросов с помощью метода из json_reader.cpp
-   const auto& stat_requests = input_json.at("stat_requests").AsArray();
-    json::Node response = request::MakeStatResponse(transport_catalogue, stat_requests, visualization_settings);
+namespace {
 
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue [make_base|process_requests|serve [socket_path]]\n"sv;
+}
 
-    // Вывод ответа в формате JSON
-    json::Print(json::Document(std::move(response)), std::cout);
-    
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    // Режимы работы со снимком базы: make_base сохраняет базу в файл, process_requests отвечает на запросы по нему
+    if (argc >= 2 && std::string_view(argv[1]) == "serve"sv && argc <= 3) {
+        request::Serve(std::cin, std::cout, (argc == 3) ? std::optional<std::string>(argv[2]) : std::nullopt);
+        return 0;
+    }
+    if (argc == 2) {
+        const std::string_view mode(argv[1]);
+        if (mode == "make_base"sv) {
+            request::MakeBase(std::cin);
+        } else if (mode == "process_requests"sv) {
+            request::ProcessRequests(std::cin, std::cout);
+        } else {
+            PrintUsage();
+            return 1;
+        }
+        return 0;
+    } else if (argc > 2) {
+        PrintUsage();
+        return 1;
+    }
+
+    // Разовый запрос: база, настройки и stat_requests в одном JSON-документе
+    request::ProcessTransportCatalogueQuery(std::cin, std::cout);
     return 0;
 }
@@ -1,13 +1,132 @@
 #include "map_renderer.h"
+#include "parallel.h"
+#include "raster.h"
 
 #include <algorithm>
-#include <fstream>
+#include <array>
+#include <cmath>
 #include <sstream>
 
 namespace render {
 
 using namespace std::literals;
 
+namespace {
+
+// Число корзин коэффициента масштабирования на каждое его удвоение
+constexpr double kZoomBucketsPerOctave = 4.;
+
+int MakeZoomBucket(double zoom) {
+    return (zoom > 0.) ? static_cast<int>(std::floor(std::log2(zoom) * kZoomBucketsPerOctave))
+                       : std::numeric_limits<int>::min();
+}
+
+// Верхняя граница масштаба корзины: допуск, пересчитанный через неё, не превышает заданного на экране
+double GetBucketMaxZoom(int zoom_bucket) {
+    return std::exp2((zoom_bucket + 1) / kZoomBucketsPerOctave);
+}
+
+// Расстояние от точки до отрезка в плоскости (lng, lat): проекция на карту линейна и одинакова по осям
+double DistanceToSegment(const geo::Coordinates& point, const geo::Coordinates& from, const geo::Coordinates& to) {
+    const double dx = to.lng - from.lng;
+    const double dy = to.lat - from.lat;
+    const double length_sq = dx * dx + dy * dy;
+
+    double t = (length_sq == 0.) ? 0. : ((point.lng - from.lng) * dx + (point.lat - from.lat) * dy) / length_sq;
+    t = std::clamp(t, 0., 1.);
+
+    return std::hypot(point.lng - (from.lng + t * dx), point.lat - (from.lat + t * dy));
+}
+
+// Объекты слоя карты, накопленные для вывода в общий контейнер
+class LayerBuffer final : public svg::ObjectContainer {
+public:
+    void AddPtr(std::unique_ptr<svg::Object>&& object) override {
+        objects_.emplace_back(std::move(object));
+    }
+
+    void MoveTo(svg::ObjectContainer& image) {
+        for (auto& object : objects_)
+            image.AddPtr(std::move(object));
+        objects_.clear();
+    }
+
+private:
+    std::vector<std::unique_ptr<svg::Object>> objects_;
+};
+
+// Упрощение ломаной алгоритмом Дугласа-Пекера (без рекурсии)
+RouteGeometryCache::Geometry SimplifyPolyline(RouteGeometryCache::Geometry points, double tolerance) {
+    if (points.size() < 3)
+        return points;
+
+    std::vector<bool> keep(points.size(), false);
+    keep.front() = keep.back() = true;
+
+    std::vector<std::pair<size_t, size_t>> ranges{{0u, points.size() - 1}};
+    while (!ranges.empty()) {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+
+        double max_distance{0.};
+        size_t farthest{first};
+        for (size_t id = first + 1; id < last; ++id) {
+            double distance = DistanceToSegment(points[id], points[first], points[last]);
+            if (distance > max_distance) {
+                max_distance = distance;
+                farthest = id;
+            }
+        }
+
+        if (max_distance > tolerance) {
+            keep[farthest] = true;
+            ranges.emplace_back(first, farthest);
+            ranges.emplace_back(farthest, last);
+        }
+    }
+
+    RouteGeometryCache::Geometry result;
+    for (size_t id = 0; id != points.size(); ++id) {
+        if (keep[id])
+            result.emplace_back(points[id]);
+    }
+    return result;
+}
+
+}  // namespace
+
+/* ROUTE GEOMETRY CACHE */
+
+std::shared_ptr<const RouteGeometryCache::Geometry> RouteGeometryCache::Find(std::string_view bus_name,
+                                                                           int zoom_bucket) const {
+    std::lock_guard guard(mutex_);
+    if (auto position = routes_.find({std::string(bus_name), zoom_bucket}); position != routes_.end())
+        return position->second;
+    return nullptr;
+}
+
+std::shared_ptr<const RouteGeometryCache::Geometry> RouteGeometryCache::Insert(std::string_view bus_name,
+                                                                             int zoom_bucket, Geometry geometry) {
+    std::lock_guard guard(mutex_);
+    auto [position, _] = routes_.emplace(std::make_pair(std::string(bus_name), zoom_bucket),
+                                         std::make_shared<const Geometry>(std::move(geometry)));
+    return position->second;
+}
+
+void RouteGeometryCache::Erase(std::string_view bus_name) {
+    std::lock_guard guard(mutex_);
+    auto position = routes_.lower_bound({std::string(bus_name), std::numeric_limits<int>::min()});
+    while (position != routes_.end() && position->first.first == bus_name)
+        position = routes_.erase(position);
+}
+
+void RouteGeometryCache::Clear() {
+    std::lock_guard guard(mutex_);
+    routes_.clear();
+}
+
+/* VISUALIZATION SETTINGS */
+
 Visualization& Visualization::SetScreen(const Screen& screen) {
     screen_ = screen;
     return *this;
@@ -28,18 +147,72 @@ Visualization& Visualization::SetLabels(LabelType type, Label label) {
 
 Visualization& Visualization::SetUnderLayer(UnderLayer layer) {
     under_layer_ = std::move(layer);
+    under_layer_.color_ = svg::SerializeColor(under_layer_.color_);
     return *this;
 }
 
 Visualization& Visualization::SetColors(std::vector<svg::Color> colors) {
-    colors_ = std::move(colors);
+    // Цвета палитры сериализуются один раз, а не при выводе каждого объекта карты
+    colors_.clear();
+    colors_.reserve(colors.size());
+    for (const auto& color : colors)
+        colors_.emplace_back(svg::SerializeColor(color));
+    return *this;
+}
+
+Visualization& Visualization::SetStyleClasses(bool enabled) {
+    use_style_classes_ = enabled;
     return *this;
 }
 
+Visualization& Visualization::SetRouteSimplification(double tolerance) {
+    simplification_tolerance_ = tolerance;
+    route_geometry_cache_->Clear();
+    return *this;
+}
+
+Visualization& Visualization::DetachCaches() {
+    route_geometry_cache_ = std::make_shared<RouteGeometryCache>();
+    escaped_names_ = std::make_shared<svg::EscapedTextCache>();
+    return *this;
+}
+
+const Screen& Visualization::GetScreen() const {
+    return screen_;
+}
+
+double Visualization::GetLineWidth() const {
+    return line_width_;
+}
+
+double Visualization::GetStopRadius() const {
+    return stop_radius_;
+}
+
+const Label& Visualization::GetLabels(LabelType type) const {
+    return labels_.at(type);
+}
+
+const UnderLayer& Visualization::GetUnderLayer() const {
+    return under_layer_;
+}
+
+const std::vector<svg::Color>& Visualization::GetColors() const {
+    return colors_;
+}
+
+double Visualization::GetRouteSimplification() const {
+    return simplification_tolerance_;
+}
+
+bool Visualization::GetStyleClasses() const {
+    return use_style_classes_;
+}
+
 /* MAP IMAGE RENDERED */
 
 MapImageRenderer::MapImageRenderer(const catalogue::TransportCatalogue& catalogue, const Visualization& settings,
-                                   svg::Document& image)
+                                   svg::ObjectContainer& image)
     : catalogue_(catalogue),
       settings_(settings),
       image_(image),
@@ -47,121 +220,202 @@ MapImageRenderer::MapImageRenderer(const catalogue::TransportCatalogue& catalogu
       max_lat_(catalogue_.GetMaxStopCoordinates().lat),
       zoom_(CalculateZoom()) {}
 
+MapImageRenderer::MapImageRenderer(const MapImageRenderer& other, svg::ObjectContainer& image)
+    : catalogue_(other.catalogue_),
+      settings_(other.settings_),
+      image_(image),
+      min_lng_(other.min_lng_),
+      max_lat_(other.max_lat_),
+      zoom_(other.zoom_) {}
+
 void MapImageRenderer::Render() {
-    PutRouteLines();
-    PutRouteNames();
-    PutStopCircles();
-    PutStopNames();
+    // Слои строятся параллельно, каждый в свой буфер, и выводятся в image_ в порядке слоёв
+    std::array<LayerBuffer, 4> layers;
+    parallel::InvokeAll([&] { MapImageRenderer(*this, layers[0]).PutRouteLines(); },
+                        [&] { MapImageRenderer(*this, layers[1]).PutRouteNames(); },
+                        [&] { MapImageRenderer(*this, layers[2]).PutStopCircles(); },
+                        [&] { MapImageRenderer(*this, layers[3]).PutStopNames(); });
+
+    for (auto& layer : layers)
+        layer.MoveTo(image_);
 }
 
 void MapImageRenderer::PutRouteLines() {
-    const double& width = settings_.line_width_;
-
     int route_id{0};
     bool is_previous_route_empty{true};
 
     for (std::string_view bus_name : catalogue_.GetOrderedBusList()) {
-        auto [bus, stops] = catalogue_.GetRouteInfo(bus_name);
+        // Если на маршруте нет остановок, следующий за ним маршрут должен использовать тот же индекс в палитре
+        route_id = is_previous_route_empty ? route_id : route_id + 1;
+        is_previous_route_empty = PutRouteLine(bus_name, route_id);
+    }
+}
 
+void MapImageRenderer::PutRouteNames() {
+    int route_id{0};
+    bool is_previous_route_empty{true};
+
+    for (std::string_view bus_name : catalogue_.GetOrderedBusList()) {
         // Если на маршруте нет остановок, следующий за ним маршрут должен использовать тот же индекс в палитре
         route_id = is_previous_route_empty ? route_id : route_id + 1;
+        is_previous_route_empty = PutRouteName(bus_name, route_id);
+    }
+}
+
+void MapImageRenderer::PutStopCircles() {
+    for (const auto& [_, stop] : catalogue_.GetAllStopsFromRoutes())
+        PutStopCircle(*stop);
+}
+
+void MapImageRenderer::PutStopNames() {
+    for (const auto& [_, stop] : catalogue_.GetAllStopsFromRoutes())
+        PutStopName(*stop);
+}
 
-        svg::Polyline route;
+/* SINGLE OBJECT METHODS */
+
+bool MapImageRenderer::PutRouteLine(std::string_view bus_name, int route_id) {
+    svg::Polyline route;
+    bool is_route_empty{true};
+
+    if (settings_.simplification_tolerance_ > 0.) {
+        auto geometry = GetSimplifiedRoute(bus_name);
+        for (const auto& point : *geometry)
+            route.AddPoint(ToScreenPosition(point));
+        is_route_empty = geometry->empty();
+    } else {
+        auto [bus, stops] = catalogue_.GetRouteInfo(bus_name);
         for (const auto& stop : stops)
             route.AddPoint(ToScreenPosition(stop->point));
+        is_route_empty = stops.empty();
+    }
+
+    image_.Add(StyleRouteLine(std::move(route), route_id));
+    return is_route_empty;
+}
+
+// Названия экранируются один раз при первом выводе, подложка и надпись ссылаются на одну и ту же строку
+bool MapImageRenderer::PutRouteName(std::string_view bus_name, int route_id) {
+    const auto& bus_settings = settings_.labels_.at(LabelType::Bus);
+    auto [bus, stops] = catalogue_.GetFinalStops(bus_name);
 
-        image_.Add(route.SetStrokeColor(TakeColorById(route_id))
-                       .SetFillColor("none"s)
-                       .SetStrokeWidth(width)
-                       .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                       .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND));
+    //Если на маршруте нет остановок, его название не рисуется
+    for (const auto& stop : stops) {
+        auto label = svg::Text()
+                         .SetEscapedData(settings_.escaped_names_->Get(bus->number))
+                         .SetPosition(ToScreenPosition(stop->point))
+                         .SetOffset(bus_settings.offset_);
 
-        is_previous_route_empty = stops.empty();
+        // Background - first
+        image_.Add(StyleBusLabel(label, route_id, true));
+        // Text - second
+        image_.Add(StyleBusLabel(std::move(label), route_id, false));
     }
+
+    return stops.empty();
 }
 
-void MapImageRenderer::PutRouteNames() {
-    const auto& bus_settings = settings_.labels_.at(LabelType::Bus);
-    const auto& under_layer_settings = settings_.under_layer_;
+void MapImageRenderer::PutStopCircle(const catalogue::Stop& stop) {
+    image_.Add(StyleStopCircle(svg::Circle().SetCenter(ToScreenPosition(stop.point)).SetRadius(settings_.stop_radius_)));
+}
 
-    int route_id{0};
-    bool is_previous_route_empty{true};
+void MapImageRenderer::PutStopName(const catalogue::Stop& stop) {
+    const auto& stop_settings = settings_.labels_.at(LabelType::Stop);
 
-    for (std::string_view bus_name : catalogue_.GetOrderedBusList()) {
-        auto [bus, stops] = catalogue_.GetFinalStops(bus_name);
+    auto label = svg::Text()
+                     .SetEscapedData(settings_.escaped_names_->Get(stop.name))
+                     .SetPosition(ToScreenPosition(stop.point))
+                     .SetOffset(stop_settings.offset_);
 
-        // Если на маршруте нет остановок, следующий за ним маршрут должен использовать тот же индекс в палитре
-        route_id = is_previous_route_empty ? route_id : route_id + 1;
+    // Background - first
+    image_.Add(StyleStopLabel(label, true));
+    // Text - second
+    image_.Add(StyleStopLabel(std::move(label), false));
+}
 
-        //Если на маршруте нет остановок, его название не рисуется
-        if (stops.empty())
-            continue;
-
-        for (const auto& stop : stops) {
-            // Background - first
-            image_.Add(svg::Text()
-                           .SetData(bus->number)
-                           .SetFillColor(under_layer_settings.color_)
-                           .SetStrokeColor(under_layer_settings.color_)
-                           .SetStrokeWidth(under_layer_settings.width_)
-                           .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                           .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
-                           .SetPosition(ToScreenPosition(stop->point))
-                           .SetOffset(bus_settings.offset_)
-                           .SetFontSize(bus_settings.font_size_)
-                           .SetFontFamily("Verdana")
-                           .SetFontWeight("bold"));
-
-            // Text - second
-            image_.Add(svg::Text()
-                           .SetData(bus->number)
-                           .SetPosition(ToScreenPosition(stop->point))
-                           .SetOffset(bus_settings.offset_)
-                           .SetFontSize(bus_settings.font_size_)
-                           .SetFontFamily("Verdana"s)
-                           .SetFontWeight("bold"s)
-                           .SetFillColor(TakeColorById(route_id)));
-        }
+/* STYLING METHODS */
+
+/*
+ * В режиме CSS-классов все повторяющиеся атрибуты выносятся в <style>:
+ * .u - подложка надписей, .b/.s - шрифт названий маршрутов/остановок, .n - цвет названий остановок,
+ * .p - круги остановок, .rN/.cN - линия и цвет названия маршрута с индексом N в палитре
+ */
+std::string MapImageRenderer::MakeStyleSheet() const {
+    if (!settings_.use_style_classes_)
+        return {};
+
+    const auto& under_layer = settings_.under_layer_;
+    const auto& bus_settings = settings_.labels_.at(LabelType::Bus);
+    const auto& stop_settings = settings_.labels_.at(LabelType::Stop);
 
-        is_previous_route_empty = stops.empty();
+    std::ostringstream css;
+    css << ".u{fill:"sv << under_layer.color_ << ";stroke:"sv << under_layer.color_
+        << ";stroke-width:"sv << under_layer.width_ << ";stroke-linecap:round;stroke-linejoin:round}"sv;
+    css << ".b{font-size:"sv << bus_settings.font_size_ << "px;font-family:Verdana;font-weight:bold}"sv;
+    css << ".s{font-size:"sv << stop_settings.font_size_ << "px;font-family:Verdana}"sv;
+    css << ".n{fill:black}.p{fill:white}"sv;
+
+    for (size_t color_id = 0; color_id != settings_.colors_.size(); ++color_id) {
+        const auto& color = settings_.colors_[color_id];
+        css << ".r"sv << color_id << "{fill:none;stroke:"sv << color << ";stroke-width:"sv << settings_.line_width_
+            << ";stroke-linecap:round;stroke-linejoin:round}"sv;
+        css << ".c"sv << color_id << "{fill:"sv << color << '}';
     }
+
+    return css.str();
 }
 
-void MapImageRenderer::PutStopCircles() {
-    for (const auto& [_, stop] : catalogue_.GetAllStopsFromRoutes())
-        image_.Add(svg::Circle()
-                       .SetCenter(ToScreenPosition(stop->point))
-                       .SetRadius(settings_.stop_radius_)
-                       .SetFillColor("white"s));
+svg::Polyline MapImageRenderer::StyleRouteLine(svg::Polyline line, int route_id) const {
+    if (settings_.use_style_classes_)
+        return std::move(line.SetClass("r"s + std::to_string(TakeColorIndex(route_id))));
+
+    return std::move(line.SetStrokeColor(TakeColorById(route_id))
+                         .SetFillColor("none"s)
+                         .SetStrokeWidth(settings_.line_width_)
+                         .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+                         .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND));
 }
 
-void MapImageRenderer::PutStopNames() {
+svg::Text MapImageRenderer::StyleBusLabel(svg::Text label, int route_id, bool is_under_layer) const {
+    const auto& bus_settings = settings_.labels_.at(LabelType::Bus);
+    const auto& under_layer_settings = settings_.under_layer_;
+
+    if (settings_.use_style_classes_)
+        return std::move(label.SetClass(is_under_layer ? "b u"s : "b c"s + std::to_string(TakeColorIndex(route_id))));
+
+    label.SetFontSize(bus_settings.font_size_).SetFontFamily("Verdana"s).SetFontWeight("bold"s);
+    if (!is_under_layer)
+        return std::move(label.SetFillColor(TakeColorById(route_id)));
+
+    return std::move(label.SetFillColor(under_layer_settings.color_)
+                         .SetStrokeColor(under_layer_settings.color_)
+                         .SetStrokeWidth(under_layer_settings.width_)
+                         .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+                         .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND));
+}
+
+svg::Text MapImageRenderer::StyleStopLabel(svg::Text label, bool is_under_layer) const {
     const auto& stop_settings = settings_.labels_.at(LabelType::Stop);
     const auto& under_layer_settings = settings_.under_layer_;
 
-    for (const auto& [_, stop] : catalogue_.GetAllStopsFromRoutes()) {
-        // Background - first
-        image_.Add(svg::Text()
-                       .SetData(stop->name)
-                       .SetFillColor(under_layer_settings.color_)
-                       .SetStrokeColor(under_layer_settings.color_)
-                       .SetStrokeWidth(under_layer_settings.width_)
-                       .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                       .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND)
-                       .SetPosition(ToScreenPosition(stop->point))
-                       .SetOffset(stop_settings.offset_)
-                       .SetFontSize(stop_settings.font_size_)
-                       .SetFontFamily("Verdana"s));
+    if (settings_.use_style_classes_)
+        return std::move(label.SetClass(is_under_layer ? "s u"s : "s n"s));
 
-        // Text - second
-        image_.Add(svg::Text()
-                       .SetData(stop->name)
-                       .SetFillColor("black"s)
-                       .SetPosition(ToScreenPosition(stop->point))
-                       .SetOffset(stop_settings.offset_)
-                       .SetFontSize(stop_settings.font_size_)
-                       .SetFontFamily("Verdana"s));
-    }
+    label.SetFontSize(stop_settings.font_size_).SetFontFamily("Verdana"s);
+    if (!is_under_layer)
+        return std::move(label.SetFillColor("black"s));
+
+    return std::move(label.SetFillColor(under_layer_settings.color_)
+                         .SetStrokeColor(under_layer_settings.color_)
+                         .SetStrokeWidth(under_layer_settings.width_)
+                         .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+                         .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND));
+}
+
+svg::Circle MapImageRenderer::StyleStopCircle(svg::Circle circle) const {
+    if (settings_.use_style_classes_)
+        return std::move(circle.SetClass("p"s));
+    return std::move(circle.SetFillColor("white"s));
 }
 
 /* HELPER METHODS */
@@ -189,9 +443,33 @@ double MapImageRenderer::CalculateZoom() const {
     return zoom;
 }
 
+size_t MapImageRenderer::TakeColorIndex(int route_id) const {
+    return route_id % settings_.colors_.size();
+}
+
 svg::Color MapImageRenderer::TakeColorById(int route_id) const {
-    unsigned int color_id = route_id % settings_.colors_.size();
-    return settings_.colors_.at(color_id);
+    return settings_.colors_.at(TakeColorIndex(route_id));
+}
+
+std::shared_ptr<const RouteGeometryCache::Geometry> MapImageRenderer::GetSimplifiedRoute(
+    std::string_view bus_name) const {
+    const int zoom_bucket = MakeZoomBucket(zoom_);
+    auto& cache = *settings_.route_geometry_cache_;
+
+    if (auto geometry = cache.Find(bus_name, zoom_bucket))
+        return geometry;
+
+    // Обратный путь некольцевого маршрута повторяет прямой по тем же точкам, поэтому выводится только прямой путь
+    auto [bus, stops] = catalogue_.GetRouteInfo(bus_name, false);
+
+    RouteGeometryCache::Geometry points;
+    points.reserve(stops.size());
+    for (const auto& stop : stops)
+        points.emplace_back(stop->point);
+
+    const double tolerance =
+        (zoom_ > 0.) ? settings_.simplification_tolerance_ / GetBucketMaxZoom(zoom_bucket) : 0.;
+    return cache.Insert(bus_name, zoom_bucket, SimplifyPolyline(std::move(points), tolerance));
 }
 
 svg::Point MapImageRenderer::ToScreenPosition(geo::Coordinates position) {
@@ -205,24 +483,253 @@ svg::Point MapImageRenderer::ToScreenPosition(geo::Coordinates position) {
     return point;
 }
 
+/* INCREMENTAL MAP RENDERER */
+
+// Контейнер, который сразу выводит добавленные объекты в выбранную строку-фрагмент
+class IncrementalMapRenderer::FragmentWriter final : public svg::ObjectContainer {
+public:  // Methods
+    void SetTarget(std::string& fragment) {
+        fragment_ = &fragment;
+    }
+
+    void AddPtr(std::unique_ptr<svg::Object>&& object) override {
+        std::ostringstream out;
+        object->Render(out);
+        *fragment_ += out.str();
+    }
+
+private:  // Fields
+    std::string* fragment_{nullptr};
+};
+
+IncrementalMapRenderer::IncrementalMapRenderer(const catalogue::TransportCatalogue& catalogue,
+                                               const Visualization& settings)
+    : catalogue_(catalogue), settings_(settings) {
+    RebuildAll();
+}
+
+IncrementalMapRenderer::IncrementalMapRenderer(const IncrementalMapRenderer& previous,
+                                               const catalogue::TransportCatalogue& catalogue,
+                                               const Visualization& settings)
+    : catalogue_(catalogue),
+      settings_(settings),
+      coordinates_min_(previous.coordinates_min_),
+      coordinates_max_(previous.coordinates_max_),
+      style_sheet_(previous.style_sheet_),
+      buses_(previous.buses_),
+      stops_(previous.stops_),
+      changed_buses_(previous.changed_buses_),
+      changed_stops_(previous.changed_stops_) {}
+
+void IncrementalMapRenderer::MarkBusChanged(std::string_view bus_name) {
+    changed_buses_.emplace(bus_name);
+}
+
+void IncrementalMapRenderer::MarkStopChanged(std::string_view stop_name) {
+    changed_stops_.emplace(stop_name);
+
+    // Линии и названия маршрутов через остановку зависят от её координат
+    if (auto buses = catalogue_.GetBusStop(stop_name)) {
+        for (std::string_view bus_name : *buses)
+            changed_buses_.emplace(bus_name);
+    }
+}
+
+void IncrementalMapRenderer::Update() {
+    // Новые границы координат меняют проекцию всех объектов карты
+    if (catalogue_.GetMinStopCoordinates() != coordinates_min_ ||
+        catalogue_.GetMaxStopCoordinates() != coordinates_max_) {
+        RebuildAll();
+        return;
+    }
+
+    FragmentWriter writer;
+    MapImageRenderer renderer{catalogue_, settings_, writer};
+
+    const auto& bus_list = catalogue_.GetOrderedBusList();
+    std::set<std::string> new_stops;
+    std::vector<std::string> released_stops;
+
+    // Шаг 1. Удаляем фрагменты автобусов, которых больше нет в каталоге
+    for (auto position = buses_.begin(); position != buses_.end();) {
+        if (bus_list.count(position->first) == 0) {
+            DetachStops(position->second, released_stops);
+            position = buses_.erase(position);
+        } else {
+            ++position;
+        }
+    }
+
+    // Шаг 2. Перерисовываем новые и изменённые маршруты, а также маршруты, у которых сдвинулся цвет палитры
+    int route_id{0};
+    bool is_previous_route_empty{true};
+
+    for (std::string_view bus_name : bus_list) {
+        route_id = is_previous_route_empty ? route_id : route_id + 1;
+        const size_t color_index = route_id % settings_.colors_.size();
+
+        auto position = buses_.find(bus_name);
+        const bool is_new = position == buses_.end();
+        if (is_new)
+            position = buses_.emplace(std::string(bus_name), BusFragments{}).first;
+
+        auto& fragments = position->second;
+        const bool is_changed = is_new || changed_buses_.count(bus_name) > 0;
+
+        if (is_changed) {
+            settings_.route_geometry_cache_->Erase(bus_name);
+            DetachStops(fragments, released_stops);
+        }
+        if (is_changed || fragments.color_index != color_index) {
+            fragments.color_index = color_index;
+            RenderBus(renderer, writer, position->first, fragments);
+        }
+        if (is_changed)
+            AttachStops(fragments, new_stops);
+
+        is_previous_route_empty = fragments.is_empty;
+    }
+
+    // Шаг 3. Остановки, через которые больше не проходит ни один маршрут, не выводятся
+    for (const auto& stop_name : released_stops) {
+        if (auto position = stops_.find(stop_name); position != stops_.end() && position->second.buses_count == 0)
+            stops_.erase(position);
+    }
+
+    // Шаг 4. Перерисовываем новые и изменённые остановки
+    new_stops.insert(changed_stops_.begin(), changed_stops_.end());
+    for (const auto& stop_name : new_stops) {
+        if (auto position = stops_.find(stop_name); position != stops_.end())
+            RenderStop(renderer, writer, position->first, position->second);
+    }
+
+    changed_buses_.clear();
+    changed_stops_.clear();
+}
+
+std::string IncrementalMapRenderer::Render() const {
+    std::ostringstream out;
+
+    svg::Document::RenderPrologue(out, style_sheet_);
+    for (const auto& [_, fragments] : buses_)
+        out << fragments.line;
+    for (const auto& [_, fragments] : buses_)
+        out << fragments.names;
+    for (const auto& [_, fragments] : stops_)
+        out << fragments.circle;
+    for (const auto& [_, fragments] : stops_)
+        out << fragments.name;
+    svg::Document::RenderEpilogue(out);
+
+    return out.str();
+}
+
+void IncrementalMapRenderer::RebuildAll() {
+    coordinates_min_ = catalogue_.GetMinStopCoordinates();
+    coordinates_max_ = catalogue_.GetMaxStopCoordinates();
+
+    buses_.clear();
+    stops_.clear();
+    changed_buses_.clear();
+    changed_stops_.clear();
+
+    FragmentWriter writer;
+    MapImageRenderer renderer{catalogue_, settings_, writer};
+    style_sheet_ = renderer.MakeStyleSheet();
+
+    int route_id{0};
+    bool is_previous_route_empty{true};
+    std::set<std::string> new_stops;
+
+    for (std::string_view bus_name : catalogue_.GetOrderedBusList()) {
+        route_id = is_previous_route_empty ? route_id : route_id + 1;
+
+        auto position = buses_.emplace(std::string(bus_name), BusFragments{}).first;
+        position->second.color_index = route_id % settings_.colors_.size();
+
+        RenderBus(renderer, writer, position->first, position->second);
+        AttachStops(position->second, new_stops);
+
+        is_previous_route_empty = position->second.is_empty;
+    }
+
+    for (const auto& stop_name : new_stops)
+        RenderStop(renderer, writer, stop_name, stops_.at(stop_name));
+}
+
+void IncrementalMapRenderer::RenderBus(MapImageRenderer& renderer, FragmentWriter& writer,
+                                       const std::string& bus_name, BusFragments& fragments) {
+    // Индекс палитры подходит вместо порядкового номера маршрута: цвет берётся по модулю размера палитры
+    const int route_id = static_cast<int>(fragments.color_index);
+
+    fragments.line.clear();
+    writer.SetTarget(fragments.line);
+    fragments.is_empty = renderer.PutRouteLine(bus_name, route_id);
+
+    fragments.names.clear();
+    writer.SetTarget(fragments.names);
+    renderer.PutRouteName(bus_name, route_id);
+
+    auto [bus, _] = catalogue_.GetFinalStops(bus_name);
+    fragments.stops = {bus->unique_stops.begin(), bus->unique_stops.end()};
+}
+
+void IncrementalMapRenderer::RenderStop(MapImageRenderer& renderer, FragmentWriter& writer,
+                                        const std::string& stop_name, StopFragments& fragments) {
+    const auto stop = catalogue_.GetStop(stop_name);
+
+    fragments.circle.clear();
+    writer.SetTarget(fragments.circle);
+    renderer.PutStopCircle(*stop);
+
+    fragments.name.clear();
+    writer.SetTarget(fragments.name);
+    renderer.PutStopName(*stop);
+}
+
+void IncrementalMapRenderer::AttachStops(const BusFragments& fragments, std::set<std::string>& new_stops) {
+    for (const auto& stop_name : fragments.stops) {
+        auto [position, is_inserted] = stops_.try_emplace(stop_name);
+        ++position->second.buses_count;
+        if (is_inserted)
+            new_stops.emplace(stop_name);
+    }
+}
+
+void IncrementalMapRenderer::DetachStops(const BusFragments& fragments, std::vector<std::string>& released_stops) {
+    for (const auto& stop_name : fragments.stops) {
+        if (auto position = stops_.find(stop_name); position != stops_.end() && --position->second.buses_count == 0)
+            released_stops.emplace_back(stop_name);
+    }
+}
+
 /* RENDERING METHODS */
 
 std::string RenderTransportMap(const catalogue::TransportCatalogue& catalogue, const Visualization& settings) {
     svg::Document image;
 
     MapImageRenderer renderer{catalogue, settings, image};
+    image.SetStyleSheet(renderer.MakeStyleSheet());
     renderer.Render();
 
-    // TODO: это временный вывод в файл (только для отладки)
-    if (true) {
-        std::ofstream out("map.svg", std::ios::trunc);  // уточниться 
-        image.Render(out);
-        out.close();
-    }
-
     std::stringstream ss;
     image.Render(ss);
     return ss.str();
 }
 
-}  // namespace render 
+std::string RenderTransportMapPng(const catalogue::TransportCatalogue& catalogue, const Visualization& settings) {
+    // На холсте нет CSS: стили объектов должны быть заданы атрибутами
+    Visualization raster_settings = settings;
+    raster_settings.SetStyleClasses(false);
+
+    raster::Canvas canvas{static_cast<int>(std::ceil(settings.GetScreen().width_)),
+                          static_cast<int>(std::ceil(settings.GetScreen().height_))};
+    raster::CanvasContainer image{canvas};
+
+    MapImageRenderer renderer{catalogue, raster_settings, image};
+    renderer.Render();
+
+    return raster::EncodePng(canvas);
+}
+
+}  // namespace render
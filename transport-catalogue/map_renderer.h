@@ -1,5 +1,9 @@
 #pragma once
 
+#include <map>
+#include <memory>
+#include <mutex>
+
 #include "svg.h"
 #include "transport_catalogue.h"
 
@@ -26,12 +30,33 @@ struct Label {
     svg::Point offset_;
 };
 
+/*
+ * Кэш упрощённой геометрии линий маршрутов.
+ * Ключ - номер автобуса и "корзина" коэффициента масштабирования: геометрия хранится в географических
+ * координатах, поэтому одна запись подходит для любой карты, масштаб которой попадает в ту же корзину.
+ */
+class RouteGeometryCache {
+public:  // Types
+    using Geometry = std::vector<geo::Coordinates>;
+
+public:  // Methods
+    [[nodiscard]] std::shared_ptr<const Geometry> Find(std::string_view bus_name, int zoom_bucket) const;
+    std::shared_ptr<const Geometry> Insert(std::string_view bus_name, int zoom_bucket, Geometry geometry);
+    void Erase(std::string_view bus_name);
+    void Clear();
+
+private:  // Fields
+    mutable std::mutex mutex_;
+    std::map<std::pair<std::string, int>, std::shared_ptr<const Geometry>> routes_;
+};
+
 /*
  *Класс хранит все настройки визуализации для рендеринга карты image3
  */
 
 class Visualization {
     friend class MapImageRenderer;
+    friend class IncrementalMapRenderer;
 
 public:  // Constructor
     Visualization() = default;
@@ -45,6 +70,26 @@ public:  // Methods
     Visualization& SetUnderLayer(UnderLayer layer);
     Visualization& SetColors(std::vector<svg::Color> colors);
 
+    // Допуск упрощения линий маршрутов в пикселях экрана (0 - линии выводятся без упрощения)
+    Visualization& SetRouteSimplification(double tolerance);
+
+    // Режим вывода: общие стили объектов выносятся в блок <style> и подключаются через CSS-классы
+    Visualization& SetStyleClasses(bool enabled);
+
+    // Копии настроек делят кэши геометрии маршрутов и экранированных названий. Настройкам для другой
+    // версии каталога нужны свои кэши: маршрут с тем же номером мог измениться, а названия удалённых
+    // объектов не должны копиться от версии к версии
+    Visualization& DetachCaches();
+
+    [[nodiscard]] const Screen& GetScreen() const;
+    [[nodiscard]] double GetLineWidth() const;
+    [[nodiscard]] double GetStopRadius() const;
+    [[nodiscard]] const Label& GetLabels(LabelType type) const;
+    [[nodiscard]] const UnderLayer& GetUnderLayer() const;
+    [[nodiscard]] const std::vector<svg::Color>& GetColors() const;
+    [[nodiscard]] double GetRouteSimplification() const;
+    [[nodiscard]] bool GetStyleClasses() const;
+
 private:  // Fields
     Screen screen_;
     double line_width_{0.};
@@ -53,6 +98,11 @@ private:  // Fields
     std::unordered_map<LabelType, Label> labels_;
     UnderLayer under_layer_;
     std::vector<svg::Color> colors_;
+
+    double simplification_tolerance_{0.};
+    bool use_style_classes_{false};
+    std::shared_ptr<RouteGeometryCache> route_geometry_cache_{std::make_shared<RouteGeometryCache>()};
+    std::shared_ptr<svg::EscapedTextCache> escaped_names_{std::make_shared<svg::EscapedTextCache>()};
 };
 
 /* MAP IMAGE RENDERED */
@@ -68,35 +118,130 @@ private:  // Fields
 
 class MapImageRenderer {
 public:  // Constructor
-    MapImageRenderer(const catalogue::TransportCatalogue& catalogue, const Visualization& settings, svg::Document& image);
+    MapImageRenderer(const catalogue::TransportCatalogue& catalogue, const Visualization& settings,
+                     svg::ObjectContainer& image);
 
 public:  // Method
     void Render();
 
+    // Содержимое блока <style> для режима CSS-классов (пустая строка, если режим выключен)
+    [[nodiscard]] std::string MakeStyleSheet() const;
+
+    /* SINGLE OBJECT METHODS */
+
+    // Возвращают true, если на маршруте нет остановок
+    bool PutRouteLine(std::string_view bus_name, int route_id);
+    bool PutRouteName(std::string_view bus_name, int route_id);
+    void PutStopCircle(const catalogue::Stop& stop);
+    void PutStopName(const catalogue::Stop& stop);
+
+private:  // Constructor
+    // Рисует теми же настройками проекции, что и other, но в другой контейнер
+    MapImageRenderer(const MapImageRenderer& other, svg::ObjectContainer& image);
+
 private:  // Method
     void PutRouteLines();
     void PutRouteNames();
     void PutStopCircles();
     void PutStopNames();
 
+    /* STYLING METHODS */
+
+    [[nodiscard]] svg::Polyline StyleRouteLine(svg::Polyline line, int route_id) const;
+    [[nodiscard]] svg::Text StyleBusLabel(svg::Text label, int route_id, bool is_under_layer) const;
+    [[nodiscard]] svg::Text StyleStopLabel(svg::Text label, bool is_under_layer) const;
+    [[nodiscard]] svg::Circle StyleStopCircle(svg::Circle circle) const;
+
     /* HELPER METHODS */
 
     [[nodiscard]] double CalculateZoom() const;
+    [[nodiscard]] size_t TakeColorIndex(int route_id) const;
     [[nodiscard]] svg::Color TakeColorById(int route_id) const;
+    [[nodiscard]] std::shared_ptr<const RouteGeometryCache::Geometry> GetSimplifiedRoute(std::string_view bus_name) const;
     svg::Point ToScreenPosition(geo::Coordinates position);
 
 private:  // Fields
     const catalogue::TransportCatalogue& catalogue_;
     const Visualization& settings_;
-    svg::Document& image_;
+    svg::ObjectContainer& image_;
 
     double min_lng_{0.};
     double max_lat_{0.};
     double zoom_{0.};
 };
 
+/*
+ * Инкрементальный рендеринг карты.
+ * Хранит отрисованные фрагменты по слоям: для каждого автобуса - линию и названия маршрута,
+ * для каждой остановки - круг и название. После изменения каталога перерисовываются только затронутые
+ * фрагменты, а полная перепроекция выполняется, только если изменились границы координат остановок.
+ */
+class IncrementalMapRenderer {
+public:  // Constructor
+    IncrementalMapRenderer(const catalogue::TransportCatalogue& catalogue, const Visualization& settings);
+
+    // Продолжает отрисовку previous для следующей версии каталога: фрагменты копируются,
+    // затронутые изменениями объекты нужно отметить и вызвать Update()
+    IncrementalMapRenderer(const IncrementalMapRenderer& previous, const catalogue::TransportCatalogue& catalogue,
+                           const Visualization& settings);
+
+public:  // Methods
+    // Изменения существующих объектов нужно отмечать явно, новые и удалённые объекты находятся в Update()
+    void MarkBusChanged(std::string_view bus_name);
+    void MarkStopChanged(std::string_view stop_name);
+
+    void Update();
+    [[nodiscard]] std::string Render() const;
+
+private:  // Types
+    class FragmentWriter;
+
+    struct BusFragments {
+        size_t color_index{0u};
+        bool is_empty{true};
+        std::set<std::string> stops;
+
+        std::string line;
+        std::string names;
+    };
+
+    struct StopFragments {
+        size_t buses_count{0u};
+
+        std::string circle;
+        std::string name;
+    };
+
+private:  // Methods
+    void RebuildAll();
+    void RenderBus(MapImageRenderer& renderer, FragmentWriter& writer, const std::string& bus_name,
+                   BusFragments& fragments);
+    void RenderStop(MapImageRenderer& renderer, FragmentWriter& writer, const std::string& stop_name,
+                    StopFragments& fragments);
+
+    void AttachStops(const BusFragments& fragments, std::set<std::string>& new_stops);
+    void DetachStops(const BusFragments& fragments, std::vector<std::string>& released_stops);
+
+private:  // Fields
+    const catalogue::TransportCatalogue& catalogue_;
+    const Visualization& settings_;
+
+    geo::Coordinates coordinates_min_{0., 0.};
+    geo::Coordinates coordinates_max_{0., 0.};
+    std::string style_sheet_;
+
+    std::map<std::string, BusFragments, std::less<>> buses_;
+    std::map<std::string, StopFragments, std::less<>> stops_;
+
+    std::set<std::string, std::less<>> changed_buses_;
+    std::set<std::string, std::less<>> changed_stops_;
+};
+
 /* RENDERING METHODS */
 
 std::string RenderTransportMap(const catalogue::TransportCatalogue& catalogue, const Visualization& settings);
 
+// Растровый вариант карты в формате PNG: те же слои, текст выводится растровым шрифтом
+std::string RenderTransportMapPng(const catalogue::TransportCatalogue& catalogue, const Visualization& settings);
+
 }  // namespace render
@@ -0,0 +1,332 @@
+#include "mapped_catalogue.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace serialization {
+
+using namespace std::literals;
+
+/*
+ * Раскладка образа (все числа в порядке байтов машины, разделы выровнены на 8 байт):
+ *   Header
+ *   StopRecord[stop_count]           - по алфавиту
+ *   BusRecord[bus_count]             - по алфавиту
+ *   uint32_t[stop_count + 1]         - начала списков автобусов остановок
+ *   uint32_t[...]                    - номера автобусов каждой остановки по возрастанию
+ *   char[...]                        - названия остановок и автобусов подряд
+ */
+struct MappedCatalogue::Header {
+    char signature[8];
+    uint32_t version;
+    uint32_t stop_count;
+    uint32_t bus_count;
+    uint32_t reserved;
+    uint64_t stops_offset;
+    uint64_t buses_offset;
+    uint64_t stop_buses_offsets_offset;
+    uint64_t stop_buses_offset;
+    uint64_t strings_offset;
+    uint64_t file_size;
+};
+
+struct MappedCatalogue::StopRecord {
+    uint32_t name_offset;
+    uint32_t name_length;
+    double lat;
+    double lng;
+};
+
+struct MappedCatalogue::BusRecord {
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t stops_count;
+    uint32_t unique_stops_count;
+    int32_t route_length;
+    uint32_t reserved;
+    double curvature;
+};
+
+namespace {
+
+constexpr char kSignature[8] = {'T', 'C', 'I', 'M', 'A', 'G', 'E', '\0'};
+constexpr uint32_t kImageVersion = 1u;
+constexpr uint64_t kSectionAlignment = 8u;
+
+uint64_t Align(uint64_t offset) {
+    return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+template <typename T>
+void AppendRaw(std::string& buffer, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+}  // namespace
+
+/* WRITER */
+
+void WriteCatalogueImage(const catalogue::TransportCatalogue& catalogue, std::ostream& output) {
+    using Header = MappedCatalogue::Header;
+    using StopRecord = MappedCatalogue::StopRecord;
+    using BusRecord = MappedCatalogue::BusRecord;
+
+    const auto& stops = catalogue.GetSortedStops();
+    const auto& bus_names = catalogue.GetOrderedBusList();
+
+    // Шаг 1. Строки и таблицы записей
+    std::string strings;
+    const auto add_string = [&strings](std::string_view text) {
+        const auto offset = static_cast<uint32_t>(strings.size());
+        strings.append(text);
+        return offset;
+    };
+
+    std::unordered_map<std::string_view, uint32_t> bus_ids;
+    std::vector<BusRecord> buses;
+    buses.reserve(bus_names.size());
+    for (std::string_view bus_name : bus_names) {
+        const auto statistics = *catalogue.GetBusStatistics(bus_name);
+        bus_ids.emplace(bus_name, static_cast<uint32_t>(buses.size()));
+        buses.push_back({add_string(bus_name), static_cast<uint32_t>(bus_name.size()),
+                         static_cast<uint32_t>(statistics.stops_count),
+                         static_cast<uint32_t>(statistics.unique_stops_count), statistics.rout_length, 0u,
+                         statistics.curvature});
+    }
+
+    std::vector<StopRecord> stop_records;
+    std::vector<uint32_t> stop_buses_offsets{0u};
+    std::vector<uint32_t> stop_buses;
+    stop_records.reserve(stops.size());
+    stop_buses_offsets.reserve(stops.size() + 1);
+    for (const auto& stop : stops) {
+        stop_records.push_back(
+            {add_string(stop->name), static_cast<uint32_t>(stop->name.size()), stop->point.lat, stop->point.lng});
+
+        // Автобусы остановки хранятся в алфавитном порядке, поэтому их номера уже идут по возрастанию
+        if (const auto buses_through_stop = catalogue.GetBusStop(stop->name)) {
+            for (std::string_view bus : *buses_through_stop)
+                stop_buses.push_back(bus_ids.at(bus));
+        }
+        stop_buses_offsets.push_back(static_cast<uint32_t>(stop_buses.size()));
+    }
+
+    // Шаг 2. Смещения разделов
+    Header header{};
+    std::memcpy(header.signature, kSignature, sizeof(kSignature));
+    header.version = kImageVersion;
+    header.stop_count = static_cast<uint32_t>(stop_records.size());
+    header.bus_count = static_cast<uint32_t>(buses.size());
+    header.stops_offset = Align(sizeof(Header));
+    header.buses_offset = Align(header.stops_offset + stop_records.size() * sizeof(StopRecord));
+    header.stop_buses_offsets_offset = Align(header.buses_offset + buses.size() * sizeof(BusRecord));
+    header.stop_buses_offset =
+        Align(header.stop_buses_offsets_offset + stop_buses_offsets.size() * sizeof(uint32_t));
+    header.strings_offset = Align(header.stop_buses_offset + stop_buses.size() * sizeof(uint32_t));
+    header.file_size = header.strings_offset + strings.size();
+
+    // Шаг 3. Образ собирается в памяти и записывается одним вызовом
+    std::string image;
+    image.reserve(header.file_size);
+    const auto append_section = [&image](uint64_t offset, const auto& items) {
+        image.resize(offset, '\0');
+        for (const auto& item : items)
+            AppendRaw(image, item);
+    };
+
+    AppendRaw(image, header);
+    append_section(header.stops_offset, stop_records);
+    append_section(header.buses_offset, buses);
+    append_section(header.stop_buses_offsets_offset, stop_buses_offsets);
+    append_section(header.stop_buses_offset, stop_buses);
+    image.resize(header.strings_offset, '\0');
+    image += strings;
+
+    output.write(image.data(), static_cast<std::streamsize>(image.size()));
+}
+
+void WriteCatalogueImage(const catalogue::TransportCatalogue& catalogue, const std::filesystem::path& file) {
+    std::ofstream output(file, std::ios::binary);
+    if (!output)
+        throw std::runtime_error("Cannot open catalogue image for writing: "s + file.string());
+
+    WriteCatalogueImage(catalogue, output);
+    if (!output.flush())
+        throw std::runtime_error("Cannot write catalogue image: "s + file.string());
+}
+
+/* MAPPED CATALOGUE */
+
+MappedCatalogue::MappedCatalogue(const std::filesystem::path& file) {
+    const int descriptor = ::open(file.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("Cannot open catalogue image: "s + file.string());
+
+    struct stat file_status {};
+    if (::fstat(descriptor, &file_status) != 0 || file_status.st_size < static_cast<off_t>(sizeof(Header))) {
+        ::close(descriptor);
+        throw std::runtime_error("Not a catalogue image: "s + file.string());
+    }
+
+    // Отображение остаётся действительным и после закрытия дескриптора
+    size_ = static_cast<size_t>(file_status.st_size);
+    void* address = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, descriptor, 0);
+    ::close(descriptor);
+    if (address == MAP_FAILED)
+        throw std::runtime_error("Cannot map catalogue image: "s + file.string());
+    data_ = static_cast<const char*>(address);
+
+    // Проверяется только заголовок: страницы с данными подгружаются при первом обращении
+    const auto& header = GetHeader();
+    const auto fits = [this](uint64_t offset, uint64_t count, uint64_t item_size) {
+        return offset <= size_ && count <= (size_ - offset) / item_size;
+    };
+    if (std::memcmp(header.signature, kSignature, sizeof(kSignature)) != 0 || header.version != kImageVersion ||
+        header.file_size != size_ || !fits(header.stops_offset, header.stop_count, sizeof(StopRecord)) ||
+        !fits(header.buses_offset, header.bus_count, sizeof(BusRecord)) ||
+        !fits(header.stop_buses_offsets_offset, header.stop_count + 1ull, sizeof(uint32_t)) ||
+        header.stop_buses_offset > size_ || header.strings_offset > size_) {
+        Unmap();
+        throw std::runtime_error("Not a catalogue image of version "s + std::to_string(kImageVersion) + ": "s +
+                                 file.string());
+    }
+}
+
+MappedCatalogue::MappedCatalogue(MappedCatalogue&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0u)) {}
+
+MappedCatalogue& MappedCatalogue::operator=(MappedCatalogue&& other) noexcept {
+    if (this != &other) {
+        Unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0u);
+    }
+    return *this;
+}
+
+MappedCatalogue::~MappedCatalogue() {
+    Unmap();
+}
+
+template <typename GetName>
+std::optional<uint32_t> MappedCatalogue::FindByName(uint32_t count, std::string_view name, GetName get_name) const {
+    uint32_t first = 0u;
+    uint32_t last = count;
+
+    while (first < last) {
+        const uint32_t middle = first + (last - first) / 2;
+        if (get_name(middle) < name)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    if (first < count && get_name(first) == name)
+        return first;
+    return std::nullopt;
+}
+
+size_t MappedCatalogue::GetStopCount() const {
+    return GetHeader().stop_count;
+}
+
+size_t MappedCatalogue::GetBusCount() const {
+    return GetHeader().bus_count;
+}
+
+std::optional<catalogue::BusStatistics> MappedCatalogue::GetBusStatistics(std::string_view bus_number) const {
+    const auto id = FindByName(GetHeader().bus_count, bus_number, [this](uint32_t id) {
+        const auto record = GetBusRecord(id);
+        return GetString(record.name_offset, record.name_length);
+    });
+    if (!id)
+        return std::nullopt;
+
+    const auto record = GetBusRecord(*id);
+    catalogue::BusStatistics result;
+    result.number = GetString(record.name_offset, record.name_length);
+    result.stops_count = record.stops_count;
+    result.unique_stops_count = record.unique_stops_count;
+    result.rout_length = record.route_length;
+    result.curvature = record.curvature;
+    return result;
+}
+
+std::optional<std::vector<std::string_view>> MappedCatalogue::GetBusStop(std::string_view stop_name) const {
+    const auto& header = GetHeader();
+    const auto id = FindByName(header.stop_count, stop_name, [this](uint32_t id) {
+        const auto record = GetStopRecord(id);
+        return GetString(record.name_offset, record.name_length);
+    });
+    if (!id)
+        return std::nullopt;
+
+    const uint32_t first = GetIndexValue(header.stop_buses_offsets_offset, *id);
+    const uint32_t last = GetIndexValue(header.stop_buses_offsets_offset, *id + 1);
+
+    std::vector<std::string_view> result;
+    result.reserve(last - first);
+    for (uint32_t position = first; position < last; ++position) {
+        const auto record = GetBusRecord(GetIndexValue(header.stop_buses_offset, position));
+        result.emplace_back(GetString(record.name_offset, record.name_length));
+    }
+    return result;
+}
+
+const MappedCatalogue::Header& MappedCatalogue::GetHeader() const {
+    // Начало отображения выровнено на границу страницы
+    return *reinterpret_cast<const Header*>(data_);
+}
+
+// Записи копируются из образа: так не нужны требования к выравниванию и псевдонимам указателей
+MappedCatalogue::StopRecord MappedCatalogue::GetStopRecord(uint32_t id) const {
+    StopRecord record;
+    std::memcpy(&record, data_ + GetHeader().stops_offset + id * sizeof(StopRecord), sizeof(record));
+    return record;
+}
+
+MappedCatalogue::BusRecord MappedCatalogue::GetBusRecord(uint32_t id) const {
+    if (id >= GetHeader().bus_count)
+        throw std::runtime_error("Catalogue image is corrupted: unknown bus"s);
+
+    BusRecord record;
+    std::memcpy(&record, data_ + GetHeader().buses_offset + id * sizeof(BusRecord), sizeof(record));
+    return record;
+}
+
+uint32_t MappedCatalogue::GetIndexValue(uint64_t section, uint32_t position) const {
+    const uint64_t offset = section + position * uint64_t{sizeof(uint32_t)};
+    if (offset + sizeof(uint32_t) > size_)
+        throw std::runtime_error("Catalogue image is corrupted: index out of range"s);
+
+    uint32_t value;
+    std::memcpy(&value, data_ + offset, sizeof(value));
+    return value;
+}
+
+std::string_view MappedCatalogue::GetString(uint32_t offset, uint32_t length) const {
+    const uint64_t begin = GetHeader().strings_offset + offset;
+    if (begin + length > size_)
+        throw std::runtime_error("Catalogue image is corrupted: string out of range"s);
+    return {data_ + begin, length};
+}
+
+void MappedCatalogue::Unmap() {
+    if (data_ != nullptr)
+        ::munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0u;
+}
+
+}  // namespace serialization
@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+ * Описание: образ каталога для отображения в память (mmap).
+ * Образ не содержит указателей: таблицы остановок и автобусов, индексы CSR и строки записаны в одном
+ * файле и ссылаются друг на друга смещениями. Запросы выполняются прямо по отображённым страницам без
+ * разбора файла, поэтому запуск не зависит от размера города, а процессы на одной машине делят одну
+ * физическую копию образа.
+ */
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+namespace serialization {
+
+// Записывает образ замороженного каталога
+void WriteCatalogueImage(const catalogue::TransportCatalogue& catalogue, std::ostream& output);
+void WriteCatalogueImage(const catalogue::TransportCatalogue& catalogue, const std::filesystem::path& file);
+
+/*
+ * Каталог, отвечающий на запросы Bus и Stop по отображённому в память образу.
+ * Названия поиска находятся двоичным поиском по таблицам, отсортированным по названию.
+ * Возвращаемые string_view указывают в отображённую память и действительны, пока жив объект.
+ */
+class MappedCatalogue {
+    friend void WriteCatalogueImage(const catalogue::TransportCatalogue& catalogue, std::ostream& output);
+
+public:  // Constructors
+    // Бросает std::runtime_error, если файл не открывается или не является образом этой версии
+    explicit MappedCatalogue(const std::filesystem::path& file);
+
+    MappedCatalogue(const MappedCatalogue&) = delete;
+    MappedCatalogue& operator=(const MappedCatalogue&) = delete;
+
+    MappedCatalogue(MappedCatalogue&& other) noexcept;
+    MappedCatalogue& operator=(MappedCatalogue&& other) noexcept;
+
+public:  // Destructor
+    ~MappedCatalogue();
+
+public:  // Methods
+    [[nodiscard]] size_t GetStopCount() const;
+    [[nodiscard]] size_t GetBusCount() const;
+
+    [[nodiscard]] std::optional<catalogue::BusStatistics> GetBusStatistics(std::string_view bus_number) const;
+
+    // Автобусы через остановку по алфавиту или std::nullopt, если остановки нет
+    [[nodiscard]] std::optional<std::vector<std::string_view>> GetBusStop(std::string_view stop_name) const;
+
+private:  // Types
+    struct Header;
+    struct StopRecord;
+    struct BusRecord;
+
+private:  // Methods
+    [[nodiscard]] const Header& GetHeader() const;
+    [[nodiscard]] StopRecord GetStopRecord(uint32_t id) const;
+    [[nodiscard]] BusRecord GetBusRecord(uint32_t id) const;
+    [[nodiscard]] uint32_t GetIndexValue(uint64_t section, uint32_t position) const;
+    [[nodiscard]] std::string_view GetString(uint32_t offset, uint32_t length) const;
+
+    // Номер записи с названием name в таблице, отсортированной по названию
+    template <typename GetName>
+    [[nodiscard]] std::optional<uint32_t> FindByName(uint32_t count, std::string_view name, GetName get_name) const;
+
+    void Unmap();
+
+private:  // Fields
+    const char* data_{nullptr};
+    size_t size_{0u};
+};
+
+}  // namespace serialization
@@ -0,0 +1,117 @@
+#include "parallel.h"
+
+namespace parallel {
+
+namespace {
+
+// Пул и номер очереди рабочего потока, в котором выполняется код; во внешних потоках - nullptr
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_queue_id = 0u;
+
+std::mutex default_pool_mutex;
+std::unique_ptr<ThreadPool> default_pool;
+size_t default_thread_count = 0u;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    const size_t worker_count = std::max<size_t>(1u, thread_count) - 1;
+
+    queues_.reserve(worker_count + 1);
+    for (size_t queue_id = 0; queue_id <= worker_count; ++queue_id)
+        queues_.emplace_back(std::make_unique<TaskQueue>());
+
+    workers_.reserve(worker_count);
+    for (size_t queue_id = 0; queue_id < worker_count; ++queue_id)
+        workers_.emplace_back([this, queue_id] { WorkerLoop(queue_id); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(sleep_mutex_);
+        is_stopping_ = true;
+    }
+    wake_up_.notify_all();
+
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return workers_.size() + 1;
+}
+
+void ThreadPool::Push(Task task) {
+    // Рабочий поток кладёт задачу в свою очередь, внешний - в общую
+    const size_t queue_id = (current_pool == this) ? current_queue_id : workers_.size();
+    {
+        std::lock_guard guard(queues_[queue_id]->mutex);
+        queues_[queue_id]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard guard(sleep_mutex_);
+        ++pending_tasks_;
+    }
+    wake_up_.notify_one();
+}
+
+bool ThreadPool::RunPendingTask() {
+    const size_t own_queue_id = (current_pool == this) ? current_queue_id : workers_.size();
+    Task task;
+
+    // Свежие свои задачи - с конца очереди (их данные ещё в кэше), чужие - самые старые, с начала
+    for (size_t shift = 0; shift < queues_.size() && !task; ++shift) {
+        auto& queue = *queues_[(own_queue_id + shift) % queues_.size()];
+        std::lock_guard guard(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        if (shift == 0u) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    --pending_tasks_;
+    task();
+    return true;
+}
+
+void ThreadPool::WorkerLoop(size_t queue_id) {
+    current_pool = this;
+    current_queue_id = queue_id;
+
+    while (true) {
+        if (RunPendingTask())
+            continue;
+
+        std::unique_lock lock(sleep_mutex_);
+        wake_up_.wait(lock, [this] { return is_stopping_ || pending_tasks_ > 0; });
+        if (is_stopping_)
+            return;
+    }
+}
+
+void SetDefaultThreadCount(size_t thread_count) {
+    std::lock_guard guard(default_pool_mutex);
+    default_thread_count = thread_count;
+    default_pool.reset();
+}
+
+ThreadPool& GetDefaultPool() {
+    std::lock_guard guard(default_pool_mutex);
+    if (!default_pool) {
+        const size_t thread_count = (default_thread_count > 0u) ? default_thread_count
+                                                                : std::max(1u, std::thread::hardware_concurrency());
+        default_pool = std::make_unique<ThreadPool>(thread_count);
+    }
+    return *default_pool;
+}
+
+}  // namespace parallel
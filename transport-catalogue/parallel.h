@@ -0,0 +1,162 @@
+#pragma once
+
+/*
+ * Описание: общий пул потоков с перехватом работы (work stealing).
+ * У каждого потока пула своя очередь задач: свои задачи поток берёт с конца, а когда они кончаются -
+ * забирает самые старые задачи из начала чужих очередей. Поток, ожидающий завершения своих задач,
+ * тем временем выполняет чужие, поэтому вложенные параллельные участки (заморозка каталога,
+ * отрисовка слоёв карты, обработка запросов) делят одни и те же потоки, а не создают новые.
+ * Пул из одного потока - детерминированный режим: все задачи выполняются по порядку в вызывающем потоке.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace parallel {
+
+class ThreadPool {
+public:  // Constructors
+    // thread_count - число потоков вместе с вызывающим; 1 - однопоточный детерминированный режим
+    explicit ThreadPool(size_t thread_count);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+public:  // Destructor
+    ~ThreadPool();
+
+public:  // Methods
+    [[nodiscard]] size_t GetThreadCount() const;
+
+    // Вызывает func(index, thread_id) для каждого index из [0, count) не более чем на thread_count потоках.
+    // thread_id из [0, thread_count) позволяет держать отдельное состояние на каждый поток: задачи с одним
+    // thread_id никогда не выполняются одновременно. Первое исключение из func пробрасывается вызывающему
+    template <typename Func>
+    void ForEachIndex(size_t count, size_t thread_count, Func func);
+
+private:  // Types
+    using Task = std::function<void()>;
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+private:  // Methods
+    void Push(Task task);
+
+    // Выполняет одну задачу из своей или чужой очереди; false - задач нет
+    bool RunPendingTask();
+
+    void WorkerLoop(size_t queue_id);
+
+private:  // Fields
+    // Очередь i < числа рабочих потоков принадлежит потоку i, последняя - для задач из внешних потоков
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    std::atomic<int64_t> pending_tasks_{0};
+    bool is_stopping_{false};
+};
+
+template <typename Func>
+void ThreadPool::ForEachIndex(size_t count, size_t thread_count, Func func) {
+    thread_count = std::max<size_t>(1u, std::min({thread_count, count, GetThreadCount()}));
+
+    if (thread_count == 1u) {
+        for (size_t index = 0; index < count; ++index)
+            func(index, 0u);
+        return;
+    }
+
+    // Индексы разбираются по одному из общего счётчика, поэтому неравные по стоимости задачи
+    // распределяются равномерно. После исключения оставшиеся индексы пропускаются
+    std::atomic<size_t> next_index{0u};
+    std::atomic<size_t> running_helpers{thread_count - 1};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto run = [&](size_t thread_id) {
+        try {
+            for (size_t index = next_index++; index < count; index = next_index++)
+                func(index, thread_id);
+        } catch (...) {
+            next_index = count;
+            std::lock_guard guard(error_mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    };
+
+    for (size_t thread_id = 1; thread_id < thread_count; ++thread_id) {
+        Push([this, &run, &running_helpers, thread_id] {
+            run(thread_id);
+
+            // Последний помощник будит вызывающий поток. Счётчик меняется под sleep_mutex_, чтобы пробуждение
+            // не потерялось; после этого локальные переменные вызова уже не используются
+            bool is_last;
+            {
+                std::lock_guard guard(sleep_mutex_);
+                is_last = running_helpers.fetch_sub(1u, std::memory_order_release) == 1u;
+            }
+            if (is_last)
+                wake_up_.notify_all();
+        });
+    }
+
+    // Вызывающий поток работает наравне с остальными, а затем помогает пулу, пока не завершатся его задачи.
+    // Когда задач нет, он спит до завершения своих помощников или до появления новой задачи
+    run(0u);
+    while (running_helpers.load(std::memory_order_acquire) > 0u) {
+        if (RunPendingTask())
+            continue;
+
+        std::unique_lock lock(sleep_mutex_);
+        wake_up_.wait(lock, [this, &running_helpers] {
+            return running_helpers.load(std::memory_order_acquire) == 0u || pending_tasks_ > 0;
+        });
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+/* DEFAULT POOL */
+
+// Задаёт число потоков общего пула (0 - по числу ядер). Вызывается до начала параллельной работы
+void SetDefaultThreadCount(size_t thread_count);
+
+// Общий пул; создаётся при первом обращении
+ThreadPool& GetDefaultPool();
+
+inline size_t GetDefaultThreadCount() {
+    return GetDefaultPool().GetThreadCount();
+}
+
+// ForEachIndex на общем пуле
+template <typename Func>
+void ForEachIndex(size_t count, size_t thread_count, Func func) {
+    GetDefaultPool().ForEachIndex(count, thread_count, std::move(func));
+}
+
+// Выполняет независимые функции параллельно и дожидается всех
+template <typename... Funcs>
+void InvokeAll(Funcs&&... funcs) {
+    const std::function<void()> tasks[] = {std::function<void()>(std::forward<Funcs>(funcs))...};
+    ForEachIndex(sizeof...(Funcs), GetDefaultThreadCount(), [&tasks](size_t index, size_t) { tasks[index](); });
+}
+
+}  // namespace parallel
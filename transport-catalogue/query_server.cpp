@@ -0,0 +1,247 @@
+#include "query_server.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+#include "json_builder.h"
+
+namespace request {
+
+using namespace std::literals;
+
+namespace {
+
+// Объём одного чтения из сокета
+constexpr size_t kSocketReadSize = 64u * 1024u;
+
+// Кадр-словарь с описанием базы или её изменений вместо stat_requests
+bool IsUpdateFrame(const json::Node& root) {
+    if (!root.IsDict())
+        return false;
+    const auto& frame = root.AsDict();
+    return frame.count("base_requests"s) > 0 || frame.count("serialization_settings"s) > 0 ||
+           frame.count("delta_requests"s) > 0;
+}
+
+// Отправляет данные целиком; false - клиент отключился
+bool SendAll(int connection, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t sent = ::send(connection, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+}  // namespace
+
+/* BUFFERS */
+
+void QueryServer::ViewBuffer::Reset(std::string_view data) {
+    // streambuf не изменяет область чтения, поэтому снятие const безопасно
+    char* begin = const_cast<char*>(data.data());
+    setg(begin, begin, begin + data.size());
+}
+
+void QueryServer::StringBuffer::Reset() {
+    data_.clear();
+}
+
+std::string& QueryServer::StringBuffer::GetString() {
+    return data_;
+}
+
+QueryServer::StringBuffer::int_type QueryServer::StringBuffer::overflow(int_type symbol) {
+    if (!traits_type::eq_int_type(symbol, traits_type::eof()))
+        data_.push_back(traits_type::to_char_type(symbol));
+    return traits_type::not_eof(symbol);
+}
+
+std::streamsize QueryServer::StringBuffer::xsputn(const char* data, std::streamsize size) {
+    data_.append(data, static_cast<size_t>(size));
+    return size;
+}
+
+/* SERVER */
+
+QueryServer::QueryServer(CatalogueRegistry& cities, BaseLoader load_base)
+    : cities_(cities), load_base_(std::move(load_base)), updater_([this] { RunUpdates(); }) {}
+
+QueryServer::~QueryServer() {
+    {
+        std::lock_guard guard(updates_mutex_);
+        is_stopping_ = true;
+    }
+    updates_ready_.notify_one();
+    updater_.join();
+}
+
+const std::string& QueryServer::HandleFrame(std::string_view frame) {
+    frame_buffer_.Reset(frame);
+    response_buffer_.Reset();
+
+    std::istream input(&frame_buffer_);
+    std::ostream output(&response_buffer_);
+
+    try {
+        auto document = json::Load(input);
+        const auto& root = document.GetRoot();
+
+        if (IsUpdateFrame(root)) {
+            const auto city = GetRequestCity(root.AsDict());
+            auto* snapshots = cities_.FindCity(city);
+            if (!snapshots)
+                throw std::invalid_argument("Unknown city: "s + std::string(city));
+
+            StartUpdate(*snapshots, std::move(document));
+            json::PrintCompact(json::Document(json::Builder().StartDict().Key("update_started"s).Value(true)
+                                                  .EndDict().Build()),
+                               output);
+            return response_buffer_.GetString();
+        }
+
+        const auto& requests = root.IsArray() ? root.AsArray() : root.AsDict().at("stat_requests"s).AsArray();
+
+        // Версии городов удерживаются до конца кадра, даже если за это время опубликованы следующие
+        cities_.PrintCompactStatResponse(requests, output);
+    } catch (const std::exception& error) {
+        response_buffer_.Reset();
+        json::PrintCompact(
+            json::Document(json::Builder().StartDict().Key("error_message"s).Value(error.what()).EndDict().Build()),
+            output);
+    }
+
+    return response_buffer_.GetString();
+}
+
+void QueryServer::StartUpdate(SnapshotManager& snapshots, json::Document document) {
+    {
+        std::lock_guard guard(updates_mutex_);
+        updates_.push_back({&snapshots, std::move(document)});
+    }
+    updates_ready_.notify_one();
+}
+
+void QueryServer::RunUpdates() {
+    while (true) {
+        Update update;
+        {
+            std::unique_lock lock(updates_mutex_);
+            updates_ready_.wait(lock, [this] { return is_stopping_ || !updates_.empty(); });
+            // Принятые кадры обновления строятся и при остановке сервера
+            if (updates_.empty())
+                return;
+            update = std::move(updates_.front());
+            updates_.pop_front();
+        }
+
+        try {
+            auto& snapshots = *update.snapshots;
+            snapshots.Publish(load_base_(update.document.GetRoot().AsDict(), *snapshots.Acquire()));
+        } catch (const std::exception& error) {
+            // Ошибка в описании базы не останавливает сервер: продолжает работать прежняя версия
+            std::cerr << "Catalogue update failed: "sv << error.what() << std::endl;
+        }
+    }
+}
+
+void QueryServer::ServeStream(std::istream& input, std::ostream& output) {
+    while (std::getline(input, line_)) {
+        if (line_.find_first_not_of(" \t\r"sv) == std::string::npos)
+            continue;
+
+        output << HandleFrame(line_) << '\n';
+        output.flush();
+    }
+}
+
+void QueryServer::ServeUnixSocket(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("Socket path is too long: "s + socket_path);
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        throw std::runtime_error("Cannot create socket: "s + std::strerror(errno));
+
+    // Файл сокета от прошлого запуска мешает bind
+    ::unlink(socket_path.c_str());
+    if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0) {
+        const std::string reason = std::strerror(errno);
+        ::close(listener);
+        throw std::runtime_error("Cannot listen on "s + socket_path + ": "s + reason);
+    }
+
+    while (true) {
+        const int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Cannot accept connection: "s + std::strerror(errno));
+        }
+
+        ServeConnection(connection);
+        ::close(connection);
+    }
+}
+
+void QueryServer::ServeConnection(int connection) {
+    socket_input_.clear();
+    size_t line_begin = 0u;
+
+    while (true) {
+        // Шаг 1. Дочитываем данные в конец буфера
+        const size_t old_size = socket_input_.size();
+        socket_input_.resize(old_size + kSocketReadSize);
+        const ssize_t received = ::recv(connection, socket_input_.data() + old_size, kSocketReadSize, 0);
+        if (received < 0 && errno == EINTR) {
+            socket_input_.resize(old_size);
+            continue;
+        }
+        socket_input_.resize(old_size + static_cast<size_t>(std::max<ssize_t>(received, 0)));
+
+        // Шаг 2. Отвечаем на все полученные целиком строки; при отключении - и на последнюю неполную
+        const bool closed = received <= 0;
+        for (size_t line_end = socket_input_.find('\n', line_begin);
+             line_end != std::string::npos || (closed && line_begin < socket_input_.size());
+             line_end = socket_input_.find('\n', line_begin)) {
+            if (line_end == std::string::npos)
+                line_end = socket_input_.size();
+
+            const std::string_view frame(socket_input_.data() + line_begin, line_end - line_begin);
+            line_begin = std::min(line_end + 1, socket_input_.size());
+            if (frame.find_first_not_of(" \t\r"sv) == std::string_view::npos)
+                continue;
+
+            HandleFrame(frame);
+            auto& response = response_buffer_.GetString();
+            response.push_back('\n');
+            if (!SendAll(connection, response))
+                return;
+        }
+        if (closed)
+            return;
+
+        // Шаг 3. Обработанные строки удаляются из буфера, его память остаётся
+        socket_input_.erase(0, line_begin);
+        line_begin = 0u;
+    }
+}
+
+}  // namespace request
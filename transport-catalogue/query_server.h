@@ -0,0 +1,110 @@
+#pragma once
+
+/*
+ * Описание: сервер запросов с каталогом, постоянно находящимся в памяти.
+ * База строится или загружается один раз, затем сервер отвечает на запросы в формате NDJSON:
+ * каждая строка - JSON-массив stat_requests (или словарь с ключом "stat_requests"),
+ * ответ на неё - одна строка с компактным JSON-массивом ответов.
+ * Кадр-словарь с base_requests, serialization_settings или delta_requests (изменения текущей версии)
+ * запускает построение новой версии базы города из поля city (по умолчанию - единственного) в фоне:
+ * до её публикации запросы обслуживает прежняя версия, каждый кадр целиком отвечает по одной версии.
+ * Буферы чтения, разбора и вывода переиспользуются между запросами.
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iosfwd>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "json.h"
+#include "catalogue_registry.h"
+#include "serialization.h"
+#include "snapshot_manager.h"
+
+namespace request {
+
+class QueryServer {
+public:  // Types
+    // Строит следующую версию базы по кадру обновления и текущей версии
+    using BaseLoader = std::function<BaseUpdate(const json::Dict&, const CatalogueSnapshot&)>;
+
+public:  // Constructor
+    // Реестр городов должен жить дольше сервера
+    QueryServer(CatalogueRegistry& cities, BaseLoader load_base);
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+public:  // Destructor
+    // Дожидается построения версий по всем принятым кадрам обновления
+    ~QueryServer();
+
+public:  // Methods
+    // Отвечает на один кадр; ответ (без перевода строки) остаётся действительным до следующего вызова.
+    // Ошибка разбора или обработки кадра не останавливает сервер: ответом будет {"error_message": ...}
+    const std::string& HandleFrame(std::string_view frame);
+
+    // Отвечает на кадры из input до конца потока. Пустые строки пропускаются
+    void ServeStream(std::istream& input, std::ostream& output);
+
+    // Принимает подключения к сокету Unix по пути socket_path и обслуживает их по очереди
+    [[noreturn]] void ServeUnixSocket(const std::string& socket_path);
+
+private:  // Types
+    // Поток чтения поверх чужого буфера: кадр разбирается без копирования
+    class ViewBuffer : public std::streambuf {
+    public:
+        void Reset(std::string_view data);
+    };
+
+    // Поток вывода в строку, которая не освобождает память между кадрами
+    class StringBuffer : public std::streambuf {
+    public:
+        void Reset();
+        [[nodiscard]] std::string& GetString();
+
+    protected:
+        int_type overflow(int_type symbol) override;
+        std::streamsize xsputn(const char* data, std::streamsize size) override;
+
+    private:
+        std::string data_;
+    };
+
+    // Кадр обновления, ожидающий построения версии
+    struct Update {
+        SnapshotManager* snapshots{nullptr};
+        json::Document document{nullptr};
+    };
+
+private:  // Methods
+    void ServeConnection(int connection);
+
+    // Ставит обновление в очередь и сразу возвращается: запросы не ждут построения версий
+    void StartUpdate(SnapshotManager& snapshots, json::Document document);
+
+    // Поток обновлений: версии строятся по очереди, в порядке кадров
+    void RunUpdates();
+
+private:  // Fields
+    CatalogueRegistry& cities_;
+    BaseLoader load_base_;
+
+    ViewBuffer frame_buffer_;
+    StringBuffer response_buffer_;
+    std::string line_;
+    std::string socket_input_;
+
+    std::mutex updates_mutex_;
+    std::condition_variable updates_ready_;
+    std::deque<Update> updates_;
+    bool is_stopping_{false};
+    std::thread updater_;  //> Запускается последним, когда остальные поля уже созданы
+};
+
+}  // namespace request
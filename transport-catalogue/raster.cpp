@@ -0,0 +1,674 @@
+#include "raster.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <unordered_map>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace raster {
+
+using namespace std::literals;
+
+namespace {
+
+/* ---------------- COLORS ---------------- */
+
+const std::unordered_map<std::string_view, Rgba8>& GetNamedColors() {
+    static const std::unordered_map<std::string_view, Rgba8> named_colors{
+        {"black"sv, {0, 0, 0, 255}},       {"white"sv, {255, 255, 255, 255}},  {"red"sv, {255, 0, 0, 255}},
+        {"green"sv, {0, 128, 0, 255}},     {"blue"sv, {0, 0, 255, 255}},       {"yellow"sv, {255, 255, 0, 255}},
+        {"orange"sv, {255, 165, 0, 255}},  {"purple"sv, {128, 0, 128, 255}},   {"gray"sv, {128, 128, 128, 255}},
+        {"grey"sv, {128, 128, 128, 255}},  {"brown"sv, {165, 42, 42, 255}},    {"pink"sv, {255, 192, 203, 255}},
+        {"cyan"sv, {0, 255, 255, 255}},    {"magenta"sv, {255, 0, 255, 255}},  {"lime"sv, {0, 255, 0, 255}},
+        {"navy"sv, {0, 0, 128, 255}},      {"teal"sv, {0, 128, 128, 255}},     {"maroon"sv, {128, 0, 0, 255}},
+        {"olive"sv, {128, 128, 0, 255}},   {"silver"sv, {192, 192, 192, 255}}, {"gold"sv, {255, 215, 0, 255}},
+        {"violet"sv, {238, 130, 238, 255}}};
+    return named_colors;
+}
+
+// Число без пробелов по краям; std::nullopt - в тексте не только число
+template <typename Number, typename... Base>
+std::optional<Number> ParseNumber(std::string_view text, Base... base) {
+    while (!text.empty() && text.front() == ' ')
+        text.remove_prefix(1);
+    while (!text.empty() && text.back() == ' ')
+        text.remove_suffix(1);
+
+    Number value{};
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, base...);
+    if (error != std::errc() || end != text.data() + text.size())
+        return std::nullopt;
+    return value;
+}
+
+uint8_t ToChannel(double value) {
+    return static_cast<uint8_t>(std::clamp(value, 0., 255.));
+}
+
+// Разбирает "rgb(r,g,b)", "rgba(r,g,b,a)" и "#rrggbb". Неизвестный или испорченный цвет - непрозрачный чёрный:
+// в SVG такая строка выводится как есть, поэтому и растровая карта не должна из-за неё ломаться
+std::optional<Rgba8> ParseColorString(std::string_view text) {
+    constexpr Rgba8 default_color{0, 0, 0, 255};
+
+    if (text.empty() || text == "none"sv)
+        return std::nullopt;
+
+    if (auto position = GetNamedColors().find(text); position != GetNamedColors().end())
+        return position->second;
+
+    if (text.front() == '#' && text.size() == 7) {
+        const auto value = ParseNumber<uint32_t>(text.substr(1), 16);
+        if (!value)
+            return default_color;
+        return Rgba8{static_cast<uint8_t>(*value >> 16), static_cast<uint8_t>(*value >> 8),
+                     static_cast<uint8_t>(*value), 255};
+    }
+
+    const size_t open = text.find('(');
+    const size_t close = text.rfind(')');
+    if (open == std::string_view::npos || close == std::string_view::npos || close < open)
+        return default_color;
+
+    std::vector<double> components;
+    std::string_view arguments = text.substr(open + 1, close - open - 1);
+    while (!arguments.empty()) {
+        const size_t comma = arguments.find(',');
+        const auto component = ParseNumber<double>(arguments.substr(0, comma));
+        if (!component)
+            return default_color;
+        components.push_back(*component);
+        arguments = (comma == std::string_view::npos) ? std::string_view{} : arguments.substr(comma + 1);
+    }
+
+    if (components.size() < 3)
+        return default_color;
+
+    const double opacity = (components.size() > 3) ? components[3] : 1.;
+    return Rgba8{ToChannel(components[0]), ToChannel(components[1]), ToChannel(components[2]),
+                 ToChannel(opacity * 255. + 0.5)};
+}
+
+struct ColorConverter {
+    std::optional<Rgba8> operator()(std::monostate) const {
+        return std::nullopt;
+    }
+    std::optional<Rgba8> operator()(const std::string& color) const {
+        return ParseColorString(color);
+    }
+    std::optional<Rgba8> operator()(svg::Rgb color) const {
+        return Rgba8{color.red, color.green, color.blue, 255};
+    }
+    std::optional<Rgba8> operator()(svg::Rgba color) const {
+        return Rgba8{color.red, color.green, color.blue, ToChannel(color.opacity * 255. + 0.5)};
+    }
+};
+
+/* ---------------- BITMAP FONT ---------------- */
+
+constexpr int kGlyphWidth = 5;
+constexpr int kGlyphHeight = 7;
+constexpr int kGlyphAdvance = kGlyphWidth + 1;
+
+// Шрифт 5x7 для символов ASCII 0x20..0x7E: 5 столбцов на символ, младший бит - верхняя строка
+constexpr std::array<std::array<uint8_t, kGlyphWidth>, 95> kFont{{
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+    {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x32}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x08, 0x14, 0x54, 0x54, 0x3C},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+    {0x00, 0x7F, 0x10, 0x28, 0x44}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+    {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02},
+}};
+
+// Символы вне ASCII заменяются прямоугольником
+constexpr std::array<uint8_t, kGlyphWidth> kMissingGlyph{0x7F, 0x41, 0x41, 0x41, 0x7F};
+
+const std::array<uint8_t, kGlyphWidth>& GetGlyph(uint32_t code_point) {
+    if (code_point >= 0x20 && code_point <= 0x7E)
+        return kFont[code_point - 0x20];
+    return kMissingGlyph;
+}
+
+// Разбивает строку UTF-8 на кодовые точки
+std::vector<uint32_t> DecodeUtf8(std::string_view text) {
+    std::vector<uint32_t> result;
+    result.reserve(text.size());
+
+    for (size_t id = 0; id < text.size();) {
+        const auto lead = static_cast<uint8_t>(text[id]);
+        const size_t length = (lead < 0x80) ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : 4;
+
+        uint32_t code_point = (length == 1) ? lead : lead & (0x7F >> length);
+        for (size_t next = 1; next < length && id + next < text.size(); ++next)
+            code_point = (code_point << 6) | (static_cast<uint8_t>(text[id + next]) & 0x3F);
+
+        result.emplace_back(code_point);
+        id += length;
+    }
+
+    return result;
+}
+
+// Обратное преобразование для экранированного текста SVG
+std::string UnescapeXml(std::string_view text) {
+    static const std::array<std::pair<std::string_view, char>, 5> entities{
+        {{"&amp;"sv, '&'}, {"&quot;"sv, '"'}, {"&apos;"sv, '\''}, {"&lt;"sv, '<'}, {"&gt;"sv, '>'}}};
+
+    std::string result;
+    result.reserve(text.size());
+
+    for (size_t id = 0; id < text.size(); ++id) {
+        if (text[id] == '&') {
+            auto entity = std::find_if(entities.begin(), entities.end(), [text, id](const auto& pair) {
+                return text.substr(id, pair.first.size()) == pair.first;
+            });
+            if (entity != entities.end()) {
+                result.push_back(entity->second);
+                id += entity->first.size() - 1;
+                continue;
+            }
+        }
+        result.push_back(text[id]);
+    }
+
+    return result;
+}
+
+/* ---------------- PNG ---------------- */
+
+const std::array<uint32_t, 256>& GetCrcTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t id = 0; id < 256; ++id) {
+            uint32_t value = id;
+            for (int bit = 0; bit < 8; ++bit)
+                value = (value & 1u) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            result[id] = value;
+        }
+        return result;
+    }();
+    return table;
+}
+
+uint32_t ComputeCrc(std::string_view data) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (char byte : data)
+        crc = GetCrcTable()[(crc ^ static_cast<uint8_t>(byte)) & 0xFFu] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+uint32_t ComputeAdler(std::string_view data) {
+    constexpr uint32_t kModulo = 65521u;
+    uint32_t a = 1u;
+    uint32_t b = 0u;
+    for (char byte : data) {
+        a = (a + static_cast<uint8_t>(byte)) % kModulo;
+        b = (b + a) % kModulo;
+    }
+    return (b << 16) | a;
+}
+
+void WriteBigEndian(std::string& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back(static_cast<char>((value >> shift) & 0xFFu));
+}
+
+void WriteChunk(std::string& out, std::string_view type, std::string_view data) {
+    std::string chunk;
+    chunk.reserve(type.size() + data.size());
+    chunk.append(type).append(data);
+
+    WriteBigEndian(out, static_cast<uint32_t>(data.size()));
+    out += chunk;
+    WriteBigEndian(out, ComputeCrc(chunk));
+}
+
+/*
+ * Сжатие deflate (RFC 1951): LZ77 с хеш-цепочками и один блок с фиксированными кодами Хаффмана.
+ * Для карт с большими одноцветными областями этого достаточно, чтобы сжать изображение в десятки раз.
+ */
+class DeflateEncoder {
+public:  // Methods
+    std::string Encode(std::string_view data) {
+        WriteBits(1, 1);  // BFINAL
+        WriteBits(1, 2);  // BTYPE = 01 (фиксированные коды)
+
+        std::vector<int> head(kHashSize, -1);
+        std::vector<int> previous(data.size(), -1);
+
+        size_t position = 0;
+        while (position < data.size()) {
+            auto [length, distance] = FindMatch(data, position, head, previous);
+
+            if (length >= kMinMatch) {
+                WriteLength(length);
+                WriteDistance(distance);
+                for (size_t id = 0; id < length; ++id)
+                    Insert(data, position + id, head, previous);
+                position += length;
+            } else {
+                WriteLiteral(static_cast<uint8_t>(data[position]));
+                Insert(data, position, head, previous);
+                ++position;
+            }
+        }
+
+        WriteLiteral(256);  // конец блока
+        if (bit_count_ > 0)
+            out_.push_back(static_cast<char>(bit_buffer_));
+        return std::move(out_);
+    }
+
+private:  // Constants
+    static constexpr size_t kMinMatch = 3;
+    static constexpr size_t kMaxMatch = 258;
+    static constexpr int kWindowSize = 32768;
+    static constexpr int kHashSize = 1 << 15;
+    static constexpr int kMaxChainLength = 16;
+
+    static constexpr std::array<uint16_t, 29> kLengthBase{3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static constexpr std::array<uint8_t, 29> kLengthExtra{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                          2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static constexpr std::array<uint16_t, 30> kDistanceBase{1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                                            33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                                            1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static constexpr std::array<uint8_t, 30> kDistanceExtra{0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                            6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+private:  // Methods
+    static int Hash(std::string_view data, size_t position) {
+        const uint32_t value = static_cast<uint8_t>(data[position]) << 16 |
+                               static_cast<uint8_t>(data[position + 1]) << 8 | static_cast<uint8_t>(data[position + 2]);
+        return static_cast<int>((value * 2654435761u) >> 17) & (kHashSize - 1);
+    }
+
+    static void Insert(std::string_view data, size_t position, std::vector<int>& head, std::vector<int>& previous) {
+        if (position + kMinMatch > data.size())
+            return;
+        const int hash = Hash(data, position);
+        previous[position] = head[hash];
+        head[hash] = static_cast<int>(position);
+    }
+
+    static std::pair<size_t, size_t> FindMatch(std::string_view data, size_t position, const std::vector<int>& head,
+                                               const std::vector<int>& previous) {
+        if (position + kMinMatch > data.size())
+            return {0u, 0u};
+
+        const size_t max_length = std::min(kMaxMatch, data.size() - position);
+        size_t best_length = 0;
+        size_t best_distance = 0;
+
+        int candidate = head[Hash(data, position)];
+        for (int chain = 0; candidate >= 0 && chain < kMaxChainLength; ++chain) {
+            const size_t distance = position - candidate;
+            if (distance > kWindowSize)
+                break;
+
+            size_t length = 0;
+            while (length < max_length && data[candidate + length] == data[position + length])
+                ++length;
+
+            if (length > best_length) {
+                best_length = length;
+                best_distance = distance;
+                if (length == max_length)
+                    break;
+            }
+            candidate = previous[candidate];
+        }
+
+        return {best_length, best_distance};
+    }
+
+    void WriteBits(uint32_t value, int count) {
+        bit_buffer_ |= value << bit_count_;
+        bit_count_ += count;
+        while (bit_count_ >= 8) {
+            out_.push_back(static_cast<char>(bit_buffer_ & 0xFFu));
+            bit_buffer_ >>= 8;
+            bit_count_ -= 8;
+        }
+    }
+
+    // Коды Хаффмана записываются начиная со старшего бита
+    void WriteHuffman(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int bit = 0; bit < length; ++bit)
+            reversed |= ((code >> bit) & 1u) << (length - 1 - bit);
+        WriteBits(reversed, length);
+    }
+
+    void WriteLiteral(uint32_t symbol) {
+        if (symbol <= 143)
+            WriteHuffman(0x30 + symbol, 8);
+        else if (symbol <= 255)
+            WriteHuffman(0x190 + symbol - 144, 9);
+        else if (symbol <= 279)
+            WriteHuffman(symbol - 256, 7);
+        else
+            WriteHuffman(0xC0 + symbol - 280, 8);
+    }
+
+    void WriteLength(size_t length) {
+        size_t code = kLengthBase.size() - 1;
+        while (kLengthBase[code] > length)
+            --code;
+        WriteLiteral(static_cast<uint32_t>(257 + code));
+        WriteBits(static_cast<uint32_t>(length - kLengthBase[code]), kLengthExtra[code]);
+    }
+
+    void WriteDistance(size_t distance) {
+        size_t code = kDistanceBase.size() - 1;
+        while (kDistanceBase[code] > distance)
+            --code;
+        WriteHuffman(static_cast<uint32_t>(code), 5);
+        WriteBits(static_cast<uint32_t>(distance - kDistanceBase[code]), kDistanceExtra[code]);
+    }
+
+private:  // Fields
+    std::string out_;
+    uint32_t bit_buffer_{0};
+    int bit_count_{0};
+};
+
+}  // namespace
+
+std::optional<Rgba8> ToRgba(const svg::Color& color) {
+    return std::visit(ColorConverter{}, color);
+}
+
+/* ---------------- CANVAS ---------------- */
+
+Canvas::Canvas(int width, int height)
+    : width_(std::max(width, 0)),
+      height_(std::max(height, 0)),
+      pixels_(static_cast<size_t>(width_) * height_ * 4, 0),
+      coverage_(static_cast<size_t>(width_) * height_, 0.f) {}
+
+void Canvas::FillCircle(svg::Point center, double radius, Rgba8 color) {
+    // Круг - вырожденная капсула с совпадающими концами
+    AccumulateCapsule(center, center, radius);
+    Composite(color);
+}
+
+void Canvas::StrokePolyline(const std::vector<svg::Point>& points, double width, Rgba8 color) {
+    if (points.empty())
+        return;
+
+    // Скруглённые концы и стыки (stroke-linecap/stroke-linejoin = round) получаются объединением капсул
+    if (points.size() == 1)
+        AccumulateCapsule(points.front(), points.front(), width / 2.);
+    for (size_t id = 1; id < points.size(); ++id)
+        AccumulateCapsule(points[id - 1], points[id], width / 2.);
+
+    Composite(color);
+}
+
+void Canvas::DrawText(svg::Point position, std::string_view text, uint32_t font_size, Rgba8 color,
+                      double halo_width) {
+    // Высота глифа 7 пикселей шрифта соответствует высоте прописной буквы: около 0.7 кегля
+    const double scale = std::max(1., std::round(font_size * 0.7 / kGlyphHeight));
+    const double halo = halo_width / 2.;
+    const double top = position.y - kGlyphHeight * scale;
+
+    double left = position.x;
+    for (uint32_t code_point : DecodeUtf8(UnescapeXml(text))) {
+        const auto& glyph = GetGlyph(code_point);
+        for (int column = 0; column < kGlyphWidth; ++column) {
+            for (int row = 0; row < kGlyphHeight; ++row) {
+                if (((glyph[column] >> row) & 1u) == 0)
+                    continue;
+                const double x = left + column * scale;
+                const double y = top + row * scale;
+                AccumulateRectangle(x - halo, y - halo, x + scale + halo, y + scale + halo);
+            }
+        }
+        left += kGlyphAdvance * scale;
+    }
+
+    Composite(color);
+}
+
+int Canvas::GetWidth() const {
+    return width_;
+}
+
+int Canvas::GetHeight() const {
+    return height_;
+}
+
+const std::vector<uint8_t>& Canvas::GetPixels() const {
+    return pixels_;
+}
+
+void Canvas::AccumulateCapsule(svg::Point a, svg::Point b, double radius) {
+    const int left = std::max(0, static_cast<int>(std::floor(std::min(a.x, b.x) - radius - 1.)));
+    const int right = std::min(width_ - 1, static_cast<int>(std::ceil(std::max(a.x, b.x) + radius + 1.)));
+    const int top = std::max(0, static_cast<int>(std::floor(std::min(a.y, b.y) - radius - 1.)));
+    const int bottom = std::min(height_ - 1, static_cast<int>(std::ceil(std::max(a.y, b.y) + radius + 1.)));
+    if (left > right || top > bottom)
+        return;
+
+    ExtendDirtyArea(left, top, right, bottom);
+
+    // Покрытие пикселя = доля, на которую его центр попадает внутрь капсулы (сглаживание на 1 пиксель)
+    const auto dx = static_cast<float>(b.x - a.x);
+    const auto dy = static_cast<float>(b.y - a.y);
+    const float length_sq = dx * dx + dy * dy;
+    const float inverse_length_sq = (length_sq > 0.f) ? 1.f / length_sq : 0.f;
+    const auto edge = static_cast<float>(radius + 0.5);
+    const auto ax = static_cast<float>(a.x);
+    const auto ay = static_cast<float>(a.y);
+
+    for (int y = top; y <= bottom; ++y) {
+        float* row = coverage_.data() + static_cast<size_t>(y) * width_;
+        const float ry = static_cast<float>(y) + 0.5f - ay;
+        int x = left;
+
+#ifdef __SSE2__
+        // Построчный обход по 4 пикселя за итерацию
+        const __m128 v_dx = _mm_set1_ps(dx);
+        const __m128 v_dy = _mm_set1_ps(dy);
+        const __m128 v_ry = _mm_set1_ps(ry);
+        const __m128 v_inverse = _mm_set1_ps(inverse_length_sq);
+        const __m128 v_edge = _mm_set1_ps(edge);
+        const __m128 v_zero = _mm_setzero_ps();
+        const __m128 v_one = _mm_set1_ps(1.f);
+        const __m128 v_steps = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+
+        for (; x + 3 <= right; x += 4) {
+            const __m128 rx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x) + 0.5f - ax), v_steps);
+
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(rx, v_dx), _mm_mul_ps(v_ry, v_dy)), v_inverse);
+            t = _mm_min_ps(_mm_max_ps(t, v_zero), v_one);
+
+            const __m128 ex = _mm_sub_ps(rx, _mm_mul_ps(t, v_dx));
+            const __m128 ey = _mm_sub_ps(v_ry, _mm_mul_ps(t, v_dy));
+            const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)));
+
+            const __m128 coverage = _mm_min_ps(_mm_max_ps(_mm_sub_ps(v_edge, distance), v_zero), v_one);
+            _mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), coverage));
+        }
+#endif
+
+        for (; x <= right; ++x) {
+            const float rx = static_cast<float>(x) + 0.5f - ax;
+            const float t = std::clamp((rx * dx + ry * dy) * inverse_length_sq, 0.f, 1.f);
+            const float distance = std::hypot(rx - t * dx, ry - t * dy);
+            row[x] = std::max(row[x], std::clamp(edge - distance, 0.f, 1.f));
+        }
+    }
+}
+
+void Canvas::AccumulateRectangle(double left, double top, double right, double bottom) {
+    const int x_begin = std::max(0, static_cast<int>(std::floor(left)));
+    const int x_end = std::min(width_ - 1, static_cast<int>(std::ceil(right)) - 1);
+    const int y_begin = std::max(0, static_cast<int>(std::floor(top)));
+    const int y_end = std::min(height_ - 1, static_cast<int>(std::ceil(bottom)) - 1);
+    if (x_begin > x_end || y_begin > y_end)
+        return;
+
+    ExtendDirtyArea(x_begin, y_begin, x_end, y_end);
+
+    // Покрытие пикселя - площадь его пересечения с прямоугольником
+    for (int y = y_begin; y <= y_end; ++y) {
+        const double cover_y = std::min<double>(y + 1, bottom) - std::max<double>(y, top);
+        float* row = coverage_.data() + static_cast<size_t>(y) * width_;
+        for (int x = x_begin; x <= x_end; ++x) {
+            const double cover_x = std::min<double>(x + 1, right) - std::max<double>(x, left);
+            row[x] = std::max(row[x], static_cast<float>(std::clamp(cover_x * cover_y, 0., 1.)));
+        }
+    }
+}
+
+void Canvas::Composite(Rgba8 color) {
+    const float source_alpha = color.alpha / 255.f;
+
+    // Смешивание "source over" для непредумноженных цветов
+    for (int y = dirty_top_; y <= dirty_bottom_; ++y) {
+        float* row = coverage_.data() + static_cast<size_t>(y) * width_;
+        uint8_t* pixel = pixels_.data() + (static_cast<size_t>(y) * width_ + dirty_left_) * 4;
+
+        for (int x = dirty_left_; x <= dirty_right_; ++x, pixel += 4) {
+            if (row[x] <= 0.f)
+                continue;
+
+            const float alpha = source_alpha * row[x];
+            const float destination_alpha = pixel[3] / 255.f * (1.f - alpha);
+            const float result_alpha = alpha + destination_alpha;
+            row[x] = 0.f;
+
+            if (result_alpha <= 0.f)
+                continue;
+
+            auto blend = [&](uint8_t source, uint8_t destination) {
+                return static_cast<uint8_t>((source * alpha + destination * destination_alpha) / result_alpha + 0.5f);
+            };
+            pixel[0] = blend(color.red, pixel[0]);
+            pixel[1] = blend(color.green, pixel[1]);
+            pixel[2] = blend(color.blue, pixel[2]);
+            pixel[3] = static_cast<uint8_t>(result_alpha * 255.f + 0.5f);
+        }
+    }
+
+    dirty_left_ = dirty_top_ = 0;
+    dirty_right_ = dirty_bottom_ = -1;
+}
+
+void Canvas::ExtendDirtyArea(int left, int top, int right, int bottom) {
+    if (dirty_right_ < dirty_left_ || dirty_bottom_ < dirty_top_) {
+        dirty_left_ = left;
+        dirty_top_ = top;
+        dirty_right_ = right;
+        dirty_bottom_ = bottom;
+        return;
+    }
+
+    dirty_left_ = std::min(dirty_left_, left);
+    dirty_top_ = std::min(dirty_top_, top);
+    dirty_right_ = std::max(dirty_right_, right);
+    dirty_bottom_ = std::max(dirty_bottom_, bottom);
+}
+
+/* ---------------- PNG ---------------- */
+
+std::string EncodePng(const Canvas& canvas) {
+    const auto width = static_cast<uint32_t>(canvas.GetWidth());
+    const auto height = static_cast<uint32_t>(canvas.GetHeight());
+    const auto& pixels = canvas.GetPixels();
+    const size_t stride = static_cast<size_t>(width) * 4;
+
+    // Каждая строка предваряется типом фильтра; фильтр Up обнуляет повторяющиеся строки одноцветных областей
+    std::string scanlines;
+    scanlines.reserve((stride + 1) * height);
+    for (size_t y = 0; y < height; ++y) {
+        scanlines.push_back(y == 0 ? '\0' : '\2');
+        for (size_t x = 0; x < stride; ++x) {
+            const uint8_t value = pixels[y * stride + x];
+            const uint8_t above = (y == 0) ? 0 : pixels[(y - 1) * stride + x];
+            scanlines.push_back(static_cast<char>(y == 0 ? value : static_cast<uint8_t>(value - above)));
+        }
+    }
+
+    // Поток zlib: заголовок, блок deflate и контрольная сумма Adler-32
+    std::string compressed{"\x78\x01"s};
+    compressed += DeflateEncoder().Encode(scanlines);
+    WriteBigEndian(compressed, ComputeAdler(scanlines));
+
+    std::string header;
+    WriteBigEndian(header, width);
+    WriteBigEndian(header, height);
+    header += "\x08\x06\x00\x00\x00"s;  // 8 бит на канал, RGBA, deflate, стандартные фильтры, без чередования
+
+    std::string png{"\x89PNG\r\n\x1a\n"s};
+    WriteChunk(png, "IHDR"sv, header);
+    WriteChunk(png, "IDAT"sv, compressed);
+    WriteChunk(png, "IEND"sv, {});
+    return png;
+}
+
+/* ---------------- CANVAS CONTAINER ---------------- */
+
+CanvasContainer::CanvasContainer(Canvas& canvas) : canvas_(canvas) {}
+
+void CanvasContainer::AddPtr(std::unique_ptr<svg::Object>&& object) {
+    auto color_of = [](const std::optional<svg::Color>& color) -> std::optional<Rgba8> {
+        return color ? ToRgba(*color) : std::nullopt;
+    };
+
+    if (const auto* circle = dynamic_cast<const svg::Circle*>(object.get())) {
+        // По умолчанию SVG заливает фигуры чёрным
+        const auto fill = circle->GetFillColor() ? color_of(circle->GetFillColor()) : Rgba8{0, 0, 0, 255};
+        if (fill)
+            canvas_.FillCircle(circle->GetCenter(), circle->GetRadius(), *fill);
+    } else if (const auto* polyline = dynamic_cast<const svg::Polyline*>(object.get())) {
+        if (const auto stroke = color_of(polyline->GetStrokeColor()))
+            canvas_.StrokePolyline(polyline->GetPoints(), polyline->GetStrokeWidth().value_or(1.), *stroke);
+    } else if (const auto* text = dynamic_cast<const svg::Text*>(object.get())) {
+        const svg::Point position{text->GetPosition().x + text->GetOffset().x,
+                                  text->GetPosition().y + text->GetOffset().y};
+        const uint32_t font_size = text->GetFontSize().value_or(16u);
+        const std::string data = text->GetEscapedData();
+
+        if (const auto stroke = color_of(text->GetStrokeColor()))
+            canvas_.DrawText(position, data, font_size, *stroke, text->GetStrokeWidth().value_or(1.));
+
+        const auto fill = text->GetFillColor() ? color_of(text->GetFillColor()) : Rgba8{0, 0, 0, 255};
+        if (fill)
+            canvas_.DrawText(position, data, font_size, *fill);
+    }
+}
+
+}  // namespace raster
@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+ * Описание: растровый вывод карты.
+ * Холст RGBA со сглаживанием (толстые ломаные, круги, текст растровым шрифтом) и встроенный
+ * кодировщик PNG. Работает только на CPU, без внешних библиотек и графического окружения.
+ */
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "svg.h"
+
+namespace raster {
+
+struct Rgba8 {
+    uint8_t red{0};
+    uint8_t green{0};
+    uint8_t blue{0};
+    uint8_t alpha{0};
+};
+
+// Переводит цвет SVG в RGBA. Для "none" и пустого цвета возвращает std::nullopt
+[[nodiscard]] std::optional<Rgba8> ToRgba(const svg::Color& color);
+
+/*
+ * Холст RGBA с прозрачным фоном.
+ * Каждая фигура сначала накапливается в маске покрытия (максимум по всем частям фигуры), а затем
+ * один раз смешивается с холстом: так места стыков сегментов не прокрашиваются дважды.
+ */
+class Canvas {
+public:  // Constructor
+    Canvas(int width, int height);
+
+public:  // Methods
+    void FillCircle(svg::Point center, double radius, Rgba8 color);
+    void StrokePolyline(const std::vector<svg::Point>& points, double width, Rgba8 color);
+
+    // Текст выводится растровым шрифтом 5x7; halo_width > 0 утолщает глифы (подложка надписи)
+    void DrawText(svg::Point position, std::string_view text, uint32_t font_size, Rgba8 color,
+                  double halo_width = 0.);
+
+    [[nodiscard]] int GetWidth() const;
+    [[nodiscard]] int GetHeight() const;
+    [[nodiscard]] const std::vector<uint8_t>& GetPixels() const;
+
+private:  // Methods
+    // Покрытие "капсулы": отрезок ab, утолщённый на radius, со скруглёнными концами
+    void AccumulateCapsule(svg::Point a, svg::Point b, double radius);
+    void AccumulateRectangle(double left, double top, double right, double bottom);
+    void Composite(Rgba8 color);
+
+    void ExtendDirtyArea(int left, int top, int right, int bottom);
+
+private:  // Fields
+    int width_{0};
+    int height_{0};
+
+    std::vector<uint8_t> pixels_;
+    std::vector<float> coverage_;
+
+    // Область маски, изменённая с момента последнего смешивания
+    int dirty_left_{0};
+    int dirty_top_{0};
+    int dirty_right_{-1};
+    int dirty_bottom_{-1};
+};
+
+// Кодирует холст в PNG (RGBA, 8 бит на канал, сжатие deflate с фиксированными кодами Хаффмана)
+[[nodiscard]] std::string EncodePng(const Canvas& canvas);
+
+/*
+ * Контейнер SVG-объектов, который сразу растеризует их на холст.
+ * Позволяет выводить на холст всё, что рисуется в svg::Document.
+ */
+class CanvasContainer final : public svg::ObjectContainer {
+public:  // Constructor
+    explicit CanvasContainer(Canvas& canvas);
+
+public:  // Methods
+    void AddPtr(std::unique_ptr<svg::Object>&& object) override;
+
+private:  // Fields
+    Canvas& canvas_;
+};
+
+}  // namespace raster
@@ -1,4 +1,10 @@
 #include "request_handler.h"
+#include "catalogue_registry.h"
+#include "parallel.h"
+#include "query_server.h"
+#include "snapshot_manager.h"
+
+#include <optional>
 #include <string>
 
 namespace request {
@@ -6,12 +12,71 @@ namespace request {
 using namespace std::literals;
 using namespace catalogue;
 
+namespace {
+
+// Настройки общего пула потоков применяются до любой параллельной работы
+request::ExecutionSettings ConfigureExecution(const json::Dict& input_json) {
+    request::ExecutionSettings execution_settings;
+    if (input_json.count("execution_settings") > 0) {
+        execution_settings = request::ParseExecutionSettings(input_json.at("execution_settings").AsDict());
+        parallel::SetDefaultThreadCount(execution_settings.thread_count);
+    }
+    return execution_settings;
+}
+
+// Готовые ответы Bus и Stop строятся, только если это включено в execution_settings и окупается на пакете:
+// разовый запрос иначе сериализовал бы весь каталог ради нескольких ответов
+std::optional<request::ResponseFragments> MakeResponseFragments(const request::ExecutionSettings& execution_settings,
+                                                                const TransportCatalogue& catalogue,
+                                                                const json::Array& stat_requests) {
+    if (!execution_settings.pre_serialize_responses ||
+        !request::IsResponseFragmentsWorthBuilding(catalogue, stat_requests))
+        return std::nullopt;
+    return std::make_optional<request::ResponseFragments>(catalogue);
+}
+
+serialization::TransportBase BuildBase(const json::Dict& input_json) {
+    serialization::TransportBase base{request::ProcessBaseRequest(input_json.at("base_requests").AsArray()),
+                                      request::ParseVisualizationSettings(input_json.at("render_settings").AsDict()),
+                                      {}};
+    if (input_json.count("routing_settings") > 0)
+        base.routing_settings = request::ParseRoutingSettings(input_json.at("routing_settings").AsDict());
+    return base;
+}
+
+// База по base_requests с настройками или из снимка по serialization_settings
+serialization::TransportBase LoadBase(const json::Dict& input_json) {
+    if (input_json.count("base_requests") > 0)
+        return BuildBase(input_json);
+    return serialization::Deserialize(
+        request::ParseSerializationSettings(input_json.at("serialization_settings").AsDict()));
+}
+
+// Следующая версия базы по кадру обновления. Изменения применяются к сжатой копии текущей версии:
+// копия строится в фоне, без удалённых объектов и с уже посчитанной статистикой неизменённых автобусов
+BaseUpdate LoadNextBase(const json::Dict& frame, const CatalogueSnapshot& current) {
+    if (frame.count("delta_requests") == 0)
+        return {LoadBase(frame), std::nullopt};
+
+    BaseUpdate update{{current.GetCatalogue().Compact(), current.GetVisualization(), current.GetRoutingSettings()},
+                      std::nullopt};
+    update.changes = request::ApplyDeltaRequests(update.base.catalogue, frame.at("delta_requests").AsArray());
+    return update;
+}
+
+}  // namespace
 
     // вариант упрощенный более понятный 
 void ProcessTransportCatalogueQuery(std::istream& input, std::ostream& output) {
     // Загружаем JSON-документ и получаем корневой узел
     json::Document doc = json::Load(input);
     const auto& input_json = doc.GetRoot().AsDict();
+    const auto execution_settings = ConfigureExecution(input_json);
+
+    if (input_json.count("cities") > 0) {
+        ProcessCitiesQuery(input_json, output);
+        return;
+    }
 
     // Формируем каталог на основе входных данных с помощью метода из json_reader.cpp
     auto transport_catalogue = request::ProcessBaseRequest(input_json.at("base_requests").AsArray());
@@ -19,11 +84,89 @@ void ProcessTransportCatalogueQuery(std::istream& input, std::ostream& output) {
     // Разбираем настройки отображения с помощью метода из json_reader.cpp
     auto visualization_settings = request::ParseVisualizationSettings(input_json.at("render_settings").AsDict());
 
-    // Формируем ответ на основе каталога и запросов с помощью метода из json_reader.cpp
-    auto response = request::MakeStatResponse(transport_catalogue, input_json.at("stat_requests").AsArray(), visualization_settings);
+    // Настройки маршрутизации необязательны
+    routing::RoutingSettings routing_settings;
+    if (input_json.count("routing_settings") > 0)
+        routing_settings = request::ParseRoutingSettings(input_json.at("routing_settings").AsDict());
+    routing::TransportRouter router(transport_catalogue, routing_settings);
+
+    // Формируем и выводим ответ на основе каталога и запросов с помощью метода из json_reader.cpp
+    const auto& stat_requests = input_json.at("stat_requests").AsArray();
+    const auto fragments = MakeResponseFragments(execution_settings, transport_catalogue, stat_requests);
+    request::PrintStatResponse(transport_catalogue, stat_requests, visualization_settings, router,
+                               fragments ? &*fragments : nullptr, output);
+}
+
+void ProcessCitiesQuery(const json::Dict& input_json, std::ostream& output) {
+    const CatalogueRegistry cities(input_json.at("cities").AsDict(), LoadBase);
+    json::Print(json::Document(cities.MakeStatResponse(input_json.at("stat_requests").AsArray())), output);
+}
+
+void MakeBase(std::istream& input) {
+    json::Document doc = json::Load(input);
+    const auto& input_json = doc.GetRoot().AsDict();
+    ConfigureExecution(input_json);
+
+    const auto base = BuildBase(input_json);
+
+    const auto serialization_settings =
+        request::ParseSerializationSettings(input_json.at("serialization_settings").AsDict());
+    serialization::Serialize(base, serialization_settings);
+    if (serialization_settings.image)
+        serialization::WriteCatalogueImage(base.catalogue, *serialization_settings.image);
+}
+
+void ProcessRequests(std::istream& input, std::ostream& output) {
+    json::Document doc = json::Load(input);
+    const auto& input_json = doc.GetRoot().AsDict();
+    const auto execution_settings = ConfigureExecution(input_json);
+
+    const auto serialization_settings =
+        request::ParseSerializationSettings(input_json.at("serialization_settings").AsDict());
+    const auto& stat_requests = input_json.at("stat_requests").AsArray();
+
+    // Необязательные изменения базы после загрузки снимка
+    const bool has_delta_requests = input_json.count("delta_requests") > 0;
+
+    // На запросы Bus и Stop отвечает образ каталога, отображённый в память: база не загружается вовсе
+    if (serialization_settings.image && !has_delta_requests && request::IsMappedCatalogueRequests(stat_requests)) {
+        const serialization::MappedCatalogue catalogue(*serialization_settings.image);
+        json::Print(json::Document(request::MakeStatResponse(catalogue, stat_requests)), output);
+        return;
+    }
+
+    // База загружается из снимка: base_requests и настройки в этом режиме не нужны
+    auto base = serialization::Deserialize(serialization_settings);
+    if (has_delta_requests)
+        request::ApplyDeltaRequests(base.catalogue, input_json.at("delta_requests").AsArray());
+    routing::TransportRouter router(base.catalogue, base.routing_settings);
+
+    const auto fragments = MakeResponseFragments(execution_settings, base.catalogue, stat_requests);
+    request::PrintStatResponse(base.catalogue, stat_requests, base.visualization, router,
+                               fragments ? &*fragments : nullptr, output);
+}
+
+void Serve(std::istream& input, std::ostream& output, const std::optional<std::string>& socket_path) {
+    // Шаг 1. Базы городов (или единственная база) строятся по base_requests или загружаются из снимков
+    CatalogueRegistry cities = [&input] {
+        const json::Document doc = json::Load(input);
+        const auto& input_json = doc.GetRoot().AsDict();
+        ConfigureExecution(input_json);
+        // Сервер отвечает многим пакетам, поэтому готовые ответы каждой версии окупаются
+        if (input_json.count("cities") > 0)
+            return CatalogueRegistry(input_json.at("cities").AsDict(), LoadBase, true);
+        return CatalogueRegistry(LoadBase(input_json), true);
+    }();
+
+    // Шаг 2. Остаток строки после описания базы не является кадром
+    std::string rest_of_line;
+    std::getline(input, rest_of_line);
 
-    // Выводим ответ в формате JSON
-    json::Print(json::Document(std::move(response)), output);
+    // Следующие версии строятся по кадрам обновления: заново или изменениями текущей версии
+    QueryServer server(cities, LoadNextBase);
+    if (socket_path)
+        server.ServeUnixSocket(*socket_path);
+    server.ServeStream(input, output);
 }
     
 }  // namespace request
@@ -5,10 +5,29 @@
  * Действует как Фасад, упрощающий взаимодействие с транспортным каталогом
  */
 
+#include <optional>
+#include <string>
+
 #include "json_reader.h"
 
 namespace request {
 
 void ProcessTransportCatalogueQuery(std::istream& input, std::ostream& output);
 
+// Несколько городов: "cities" - словарь "идентификатор -> описание базы" (base_requests с настройками
+// или serialization_settings снимка), запросы stat_requests направляются в город из поля city.
+// Настройки execution_settings должны быть уже применены
+void ProcessCitiesQuery(const json::Dict& input_json, std::ostream& output);
+
+// Режим make_base: строит базу по base_requests и сохраняет её в файл из serialization_settings
+void MakeBase(std::istream& input);
+
+// Режим process_requests: загружает базу из файла из serialization_settings, применяет к ней необязательные
+// delta_requests (см. ApplyDeltaRequests) и отвечает на stat_requests
+void ProcessRequests(std::istream& input, std::ostream& output);
+
+// Режим serve: первым значением input читается описание базы (base_requests с настройками, "cities" или
+// serialization_settings снимка), затем сервер отвечает на кадры NDJSON из input или из сокета Unix
+void Serve(std::istream& input, std::ostream& output, const std::optional<std::string>& socket_path);
+
 }  // namespace request 
@@ -0,0 +1,375 @@
+#include "serialization.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace serialization {
+
+using namespace std::literals;
+
+namespace {
+
+// Заголовок файла: сигнатура и версия формата. Версия увеличивается при любом изменении раскладки
+constexpr std::string_view kSignature = "TCDB"sv;
+constexpr uint32_t kFormatVersion = 1u;
+
+// Наименьшие размеры записей каталога: длина пустого названия и поля фиксированного размера
+constexpr size_t kStopRecordSize = sizeof(uint32_t) + 2u * sizeof(double);
+constexpr size_t kDistanceRecordSize = 2u * sizeof(uint32_t) + sizeof(int32_t);
+constexpr size_t kBusRecordSize = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t);
+
+/* WRITER */
+
+class Writer {
+public:  // Constructor
+    explicit Writer(std::ostream& output) : output_(output) {}
+
+public:  // Methods
+    // Числа записываются в порядке байтов машины: снимок переносится только между машинами одной архитектуры
+    template <typename T>
+    void Write(T value) {
+        static_assert(std::is_arithmetic_v<T>);
+        output_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void WriteString(std::string_view text) {
+        Write(static_cast<uint32_t>(text.size()));
+        output_.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    void WritePoint(const svg::Point& point) {
+        Write(point.x);
+        Write(point.y);
+    }
+
+    void WriteColor(const svg::Color& color) {
+        Write(static_cast<uint8_t>(color.index()));
+        if (const auto* text = std::get_if<std::string>(&color)) {
+            WriteString(*text);
+        } else if (const auto* rgba = std::get_if<svg::Rgba>(&color)) {
+            WriteRgb(*rgba);
+            Write(rgba->opacity);
+        } else if (const auto* rgb = std::get_if<svg::Rgb>(&color)) {
+            WriteRgb(*rgb);
+        }
+    }
+
+private:  // Methods
+    void WriteRgb(const svg::Rgb& color) {
+        Write(color.red);
+        Write(color.green);
+        Write(color.blue);
+    }
+
+private:  // Fields
+    std::ostream& output_;
+};
+
+/* READER */
+
+// Разбирает снимок, прочитанный в память целиком
+class Reader {
+public:  // Constructor
+    explicit Reader(std::string_view data) : data_(data) {}
+
+public:  // Methods
+    template <typename T>
+    T Read() {
+        static_assert(std::is_arithmetic_v<T>);
+        T value;
+        std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+
+    std::string_view ReadBytes(size_t size) {
+        return Take(size);
+    }
+
+    std::string_view ReadString() {
+        return Take(Read<uint32_t>());
+    }
+
+    // Число записей, каждая из которых занимает не меньше min_record_size байт. Счётчик проверяется
+    // по остатку файла до выделения памяти под записи: испорченное число не приводит к bad_alloc
+    size_t ReadCount(size_t min_record_size) {
+        const size_t count = Read<uint32_t>();
+        if (count > (data_.size() - position_) / min_record_size)
+            throw std::runtime_error("Transport base is corrupted: record count exceeds file size"s);
+        return count;
+    }
+
+    svg::Point ReadPoint() {
+        const double x = Read<double>();
+        return {x, Read<double>()};
+    }
+
+    svg::Color ReadColor() {
+        switch (Read<uint8_t>()) {
+            case 0u:
+                return std::monostate{};
+            case 1u:
+                return std::string(ReadString());
+            case 2u:
+                return ReadRgb();
+            case 3u: {
+                const auto rgb = ReadRgb();
+                return svg::Rgba(rgb.red, rgb.green, rgb.blue, Read<double>());
+            }
+            default:
+                throw std::runtime_error("Transport base is corrupted: unknown color type"s);
+        }
+    }
+
+    [[nodiscard]] bool IsFinished() const {
+        return position_ == data_.size();
+    }
+
+private:  // Methods
+    std::string_view Take(size_t size) {
+        if (size > data_.size() - position_)
+            throw std::runtime_error("Transport base is corrupted: unexpected end of file"s);
+        const auto result = data_.substr(position_, size);
+        position_ += size;
+        return result;
+    }
+
+    svg::Rgb ReadRgb() {
+        const auto red = Read<uint8_t>();
+        const auto green = Read<uint8_t>();
+        return {red, green, Read<uint8_t>()};
+    }
+
+private:  // Fields
+    std::string_view data_;
+    size_t position_{0u};
+};
+
+/* SECTIONS */
+
+void WriteCatalogue(const catalogue::TransportCatalogue& catalogue, Writer& writer) {
+    // Остановки - в алфавитном порядке, дальше на них ссылаются по номеру в этом списке
+    const auto& stops = catalogue.GetSortedStops();
+    std::unordered_map<std::string_view, uint32_t> stop_ids;
+    stop_ids.reserve(stops.size());
+
+    writer.Write(static_cast<uint32_t>(stops.size()));
+    for (const auto& stop : stops) {
+        stop_ids.emplace(stop->name, static_cast<uint32_t>(stop_ids.size()));
+        writer.WriteString(stop->name);
+        writer.Write(stop->point.lat);
+        writer.Write(stop->point.lng);
+    }
+
+    std::vector<std::tuple<uint32_t, uint32_t, int>> distances;
+    catalogue.ForEachDistance([&](const catalogue::Stop& from, const catalogue::Stop& to, int distance) {
+        distances.emplace_back(stop_ids.at(from.name), stop_ids.at(to.name), distance);
+    });
+    std::sort(distances.begin(), distances.end());
+
+    writer.Write(static_cast<uint32_t>(distances.size()));
+    for (const auto& [from, to, distance] : distances) {
+        writer.Write(from);
+        writer.Write(to);
+        writer.Write(static_cast<int32_t>(distance));
+    }
+
+    const auto& buses = catalogue.GetOrderedBusList();
+    writer.Write(static_cast<uint32_t>(buses.size()));
+    for (std::string_view bus_name : buses) {
+        const auto bus = catalogue.GetBus(bus_name);
+        writer.WriteString(bus->number);
+        writer.Write(static_cast<uint8_t>(bus->type == catalogue::RouteType::CIRCLE));
+        writer.Write(static_cast<uint32_t>(bus->stop_names.size()));
+        for (std::string_view stop : bus->stop_names)
+            writer.Write(stop_ids.at(stop));
+    }
+}
+
+catalogue::TransportCatalogue ReadCatalogue(Reader& reader) {
+    catalogue::TransportCatalogue catalogue;
+
+    // Названия ссылаются на буфер снимка: каталог хранит собственные копии, а буфер живёт до конца разбора
+    std::vector<std::string_view> stop_names(reader.ReadCount(kStopRecordSize));
+    for (auto& name : stop_names) {
+        name = reader.ReadString();
+
+        catalogue::Stop stop;
+        stop.name = std::string(name);
+        stop.point.lat = reader.Read<double>();
+        stop.point.lng = reader.Read<double>();
+        catalogue.AddStop(std::move(stop));
+    }
+
+    const auto get_stop_name = [&stop_names](uint32_t id) {
+        if (id >= stop_names.size())
+            throw std::runtime_error("Transport base is corrupted: unknown stop"s);
+        return stop_names[id];
+    };
+
+    for (auto count = reader.ReadCount(kDistanceRecordSize); count > 0; --count) {
+        const auto from = get_stop_name(reader.Read<uint32_t>());
+        const auto to = get_stop_name(reader.Read<uint32_t>());
+        catalogue.AddDistance(from, to, reader.Read<int32_t>());
+    }
+
+    for (auto count = reader.ReadCount(kBusRecordSize); count > 0; --count) {
+        catalogue::Bus bus;
+        bus.number = std::string(reader.ReadString());
+        bus.type = reader.Read<uint8_t>() != 0u ? catalogue::RouteType::CIRCLE
+                                                : catalogue::RouteType::TWO_DIRECTIONAL;
+        bus.stop_names.resize(reader.ReadCount(sizeof(uint32_t)));
+        for (auto& stop : bus.stop_names)
+            stop = get_stop_name(reader.Read<uint32_t>());
+        catalogue.AddBus(std::move(bus));
+    }
+
+    catalogue.Freeze();
+    return catalogue;
+}
+
+void WriteLabel(const render::Label& label, Writer& writer) {
+    writer.Write(static_cast<int32_t>(label.font_size_));
+    writer.WritePoint(label.offset_);
+}
+
+render::Label ReadLabel(Reader& reader) {
+    render::Label label;
+    label.font_size_ = reader.Read<int32_t>();
+    label.offset_ = reader.ReadPoint();
+    return label;
+}
+
+void WriteVisualization(const render::Visualization& settings, Writer& writer) {
+    const auto& screen = settings.GetScreen();
+    writer.Write(screen.width_);
+    writer.Write(screen.height_);
+    writer.Write(screen.padding_);
+
+    writer.Write(settings.GetLineWidth());
+    writer.Write(settings.GetStopRadius());
+    WriteLabel(settings.GetLabels(render::LabelType::Stop), writer);
+    WriteLabel(settings.GetLabels(render::LabelType::Bus), writer);
+
+    writer.WriteColor(settings.GetUnderLayer().color_);
+    writer.Write(settings.GetUnderLayer().width_);
+
+    writer.Write(static_cast<uint32_t>(settings.GetColors().size()));
+    for (const auto& color : settings.GetColors())
+        writer.WriteColor(color);
+
+    writer.Write(settings.GetRouteSimplification());
+    writer.Write(static_cast<uint8_t>(settings.GetStyleClasses()));
+}
+
+render::Visualization ReadVisualization(Reader& reader) {
+    render::Screen screen;
+    screen.width_ = reader.Read<double>();
+    screen.height_ = reader.Read<double>();
+    screen.padding_ = reader.Read<double>();
+
+    const double line_width = reader.Read<double>();
+    const double stop_radius = reader.Read<double>();
+    const auto stop_label = ReadLabel(reader);
+    const auto bus_label = ReadLabel(reader);
+
+    render::UnderLayer under_layer;
+    under_layer.color_ = reader.ReadColor();
+    under_layer.width_ = reader.Read<double>();
+
+    std::vector<svg::Color> colors(reader.ReadCount(sizeof(uint8_t)));
+    for (auto& color : colors)
+        color = reader.ReadColor();
+
+    render::Visualization settings;
+    settings.SetScreen(screen)
+        .SetLineWidth(line_width)
+        .SetStopRadius(stop_radius)
+        .SetLabels(render::LabelType::Stop, stop_label)
+        .SetLabels(render::LabelType::Bus, bus_label)
+        .SetUnderLayer(std::move(under_layer))
+        .SetColors(std::move(colors));
+
+    const double simplification_tolerance = reader.Read<double>();
+    if (simplification_tolerance > 0.)
+        settings.SetRouteSimplification(simplification_tolerance);
+    settings.SetStyleClasses(reader.Read<uint8_t>() != 0u);
+
+    return settings;
+}
+
+void WriteRoutingSettings(const routing::RoutingSettings& settings, Writer& writer) {
+    writer.Write(settings.bus_wait_time);
+    writer.Write(settings.bus_velocity);
+    writer.Write(static_cast<uint8_t>(settings.use_contraction_hierarchies));
+}
+
+routing::RoutingSettings ReadRoutingSettings(Reader& reader) {
+    routing::RoutingSettings settings;
+    settings.bus_wait_time = reader.Read<double>();
+    settings.bus_velocity = reader.Read<double>();
+    settings.use_contraction_hierarchies = reader.Read<uint8_t>() != 0u;
+    return settings;
+}
+
+}  // namespace
+
+void Serialize(const TransportBase& base, std::ostream& output) {
+    Writer writer(output);
+
+    output.write(kSignature.data(), static_cast<std::streamsize>(kSignature.size()));
+    writer.Write(kFormatVersion);
+
+    WriteCatalogue(base.catalogue, writer);
+    WriteVisualization(base.visualization, writer);
+    WriteRoutingSettings(base.routing_settings, writer);
+}
+
+void Serialize(const TransportBase& base, const SerializationSettings& settings) {
+    std::ofstream output(settings.file, std::ios::binary);
+    if (!output)
+        throw std::runtime_error("Cannot open transport base for writing: "s + settings.file.string());
+
+    Serialize(base, output);
+    if (!output.flush())
+        throw std::runtime_error("Cannot write transport base: "s + settings.file.string());
+}
+
+TransportBase Deserialize(std::istream& input) {
+    // Шаг 1. Файл читается в память одним последовательным чтением
+    const std::string data{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    Reader reader(data);
+
+    // Шаг 2. Проверка заголовка
+    if (data.size() < kSignature.size() || reader.ReadBytes(kSignature.size()) != kSignature)
+        throw std::runtime_error("Not a transport base file"s);
+    if (const auto version = reader.Read<uint32_t>(); version != kFormatVersion)
+        throw std::runtime_error("Unsupported transport base version: "s + std::to_string(version));
+
+    // Шаг 3. Разделы в порядке записи
+    auto catalogue = ReadCatalogue(reader);
+    auto visualization = ReadVisualization(reader);
+    auto routing_settings = ReadRoutingSettings(reader);
+
+    if (!reader.IsFinished())
+        throw std::runtime_error("Transport base is corrupted: unexpected data at the end of file"s);
+
+    return {std::move(catalogue), std::move(visualization), routing_settings};
+}
+
+TransportBase Deserialize(const SerializationSettings& settings) {
+    std::ifstream input(settings.file, std::ios::binary);
+    if (!input)
+        throw std::runtime_error("Cannot open transport base: "s + settings.file.string());
+    return Deserialize(input);
+}
+
+}  // namespace serialization
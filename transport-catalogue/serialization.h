@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ * Описание: двоичный снимок базы транспортного справочника.
+ * Снимок содержит остановки, расстояния, маршруты и настройки отрисовки и маршрутизации.
+ * Файл читается целиком одним вызовом и разбирается последовательно: без разбора JSON и поиска по названиям
+ * (остановки в расстояниях и маршрутах записаны номерами).
+ */
+
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace serialization {
+
+struct SerializationSettings {
+    std::filesystem::path file;
+    std::optional<std::filesystem::path> image;  //> Образ каталога для отображения в память, см. mapped_catalogue.h
+};
+
+// Всё, что нужно для ответа на stat_requests без base_requests
+struct TransportBase {
+    catalogue::TransportCatalogue catalogue;
+    render::Visualization visualization;
+    routing::RoutingSettings routing_settings;
+};
+
+// Каталог должен быть заморожен
+void Serialize(const TransportBase& base, std::ostream& output);
+void Serialize(const TransportBase& base, const SerializationSettings& settings);
+
+// Бросает std::runtime_error, если файл повреждён или записан другой версией формата
+[[nodiscard]] TransportBase Deserialize(std::istream& input);
+[[nodiscard]] TransportBase Deserialize(const SerializationSettings& settings);
+
+}  // namespace serialization
@@ -0,0 +1,108 @@
+#include "snapshot_manager.h"
+
+#include <atomic>
+#include <utility>
+
+namespace request {
+
+/* SNAPSHOT */
+
+CatalogueSnapshot::CatalogueSnapshot(serialization::TransportBase base, uint64_t version)
+    : version_(version),
+      base_{std::move(base.catalogue), std::move(base.visualization.DetachCaches()),
+            base.routing_settings},
+      router_(base_.catalogue, base_.routing_settings) {}
+
+CatalogueSnapshot::CatalogueSnapshot(serialization::TransportBase base, uint64_t version,
+                                     const CatalogueSnapshot& previous, const catalogue::CatalogueChanges& changes)
+    : CatalogueSnapshot(std::move(base), version) {
+    // Предыдущая версия ещё не рисовала карту - эта нарисует её целиком при первом запросе
+    if (!previous.has_map_renderer_.load(std::memory_order_acquire))
+        return;
+
+    map_renderer_ = std::make_unique<render::IncrementalMapRenderer>(*previous.map_renderer_, base_.catalogue,
+                                                                     base_.visualization);
+    for (const auto& bus_name : changes.buses)
+        map_renderer_->MarkBusChanged(bus_name);
+    for (const auto& stop_name : changes.stops)
+        map_renderer_->MarkStopChanged(stop_name);
+    map_renderer_->Update();
+    has_map_renderer_.store(true, std::memory_order_release);
+}
+
+uint64_t CatalogueSnapshot::GetVersion() const {
+    return version_;
+}
+
+const catalogue::TransportCatalogue& CatalogueSnapshot::GetCatalogue() const {
+    return base_.catalogue;
+}
+
+const render::Visualization& CatalogueSnapshot::GetVisualization() const {
+    return base_.visualization;
+}
+
+const routing::RoutingSettings& CatalogueSnapshot::GetRoutingSettings() const {
+    return base_.routing_settings;
+}
+
+const routing::TransportRouter& CatalogueSnapshot::GetRouter() const {
+    return router_;
+}
+
+std::string CatalogueSnapshot::RenderMap() const {
+    std::call_once(map_flag_, [this] {
+        if (!map_renderer_)
+            map_renderer_ = std::make_unique<render::IncrementalMapRenderer>(base_.catalogue, base_.visualization);
+        has_map_renderer_.store(true, std::memory_order_release);
+    });
+    return map_renderer_->Render();
+}
+
+const ResponseFragments& CatalogueSnapshot::GetResponseFragments() const {
+    std::call_once(fragments_flag_, [this] { fragments_.emplace(base_.catalogue, true); });
+    return *fragments_;
+}
+
+/* MANAGER */
+
+SnapshotManager::SnapshotManager(serialization::TransportBase base, bool prepare_responses)
+    : prepare_responses_(prepare_responses),
+      current_(std::make_shared<const CatalogueSnapshot>(std::move(base), 1u)) {
+    if (prepare_responses_)
+        static_cast<void>(current_->GetResponseFragments());
+}
+
+std::shared_ptr<const CatalogueSnapshot> SnapshotManager::Acquire() const {
+    return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+}
+
+std::shared_ptr<const CatalogueSnapshot> SnapshotManager::Publish(serialization::TransportBase base) {
+    std::lock_guard guard(writer_mutex_);
+
+    // Текущую версию меняет только писатель, который держит writer_mutex_
+    const uint64_t version = Acquire()->GetVersion() + 1u;
+    auto snapshot = std::make_shared<const CatalogueSnapshot>(std::move(base), version);
+    if (prepare_responses_)
+        static_cast<void>(snapshot->GetResponseFragments());
+    std::atomic_store_explicit(&current_, snapshot, std::memory_order_release);
+    return snapshot;
+}
+
+std::shared_ptr<const CatalogueSnapshot> SnapshotManager::Publish(BaseUpdate update) {
+    if (!update.changes)
+        return Publish(std::move(update.base));
+
+    std::lock_guard guard(writer_mutex_);
+
+    // Изменения отсчитаны от текущей версии, а сменить её может только этот писатель
+    const auto current = Acquire();
+    auto snapshot = std::make_shared<const CatalogueSnapshot>(std::move(update.base), current->GetVersion() + 1u,
+                                                              *current, *update.changes);
+    if (prepare_responses_)
+        static_cast<void>(snapshot->GetResponseFragments());
+    std::atomic_store_explicit(&current_, snapshot, std::memory_order_release);
+    return snapshot;
+}
+
+}  // namespace request
@@ -0,0 +1,98 @@
+#pragma once
+
+/*
+ * Описание: версии базы транспортного справочника для обновления без остановки запросов.
+ * Читатель берёт текущую версию без блокировок и работает с ней до конца запроса; писатель строит
+ * следующую версию в стороне и публикует её атомарной заменой указателя. Старая версия освобождается,
+ * когда её отпускает последний читатель.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace request {
+
+// Следующая версия базы. changes задаются, если база получена из текущей версии пакетом изменений
+struct BaseUpdate {
+    serialization::TransportBase base;
+    std::optional<catalogue::CatalogueChanges> changes;
+};
+
+/*
+ * Неизменяемая версия базы. Маршрутизатор, кэши карты (геометрия маршрутов, экранированные названия) и
+ * статистика автобусов (она строится при заморозке каталога) принадлежат версии, поэтому кэши разных версий
+ * не пересекаются
+ */
+class CatalogueSnapshot {
+public:  // Constructor
+    // Каталог должен быть заморожен
+    CatalogueSnapshot(serialization::TransportBase base, uint64_t version);
+
+    // Версия, полученная из previous изменениями changes: отрисовка карты previous продолжается,
+    // перерисовываются только затронутые автобусы и остановки
+    CatalogueSnapshot(serialization::TransportBase base, uint64_t version, const CatalogueSnapshot& previous,
+                      const catalogue::CatalogueChanges& changes);
+
+    // Маршрутизатор ссылается на каталог версии, поэтому версия не копируется и не перемещается
+    CatalogueSnapshot(const CatalogueSnapshot&) = delete;
+    CatalogueSnapshot& operator=(const CatalogueSnapshot&) = delete;
+
+public:  // Methods
+    [[nodiscard]] uint64_t GetVersion() const;
+    [[nodiscard]] const catalogue::TransportCatalogue& GetCatalogue() const;
+    [[nodiscard]] const render::Visualization& GetVisualization() const;
+    [[nodiscard]] const routing::RoutingSettings& GetRoutingSettings() const;
+    [[nodiscard]] const routing::TransportRouter& GetRouter() const;
+
+    // SVG-карта версии. Рендерер создаётся при первом запросе и переходит к следующим версиям
+    [[nodiscard]] std::string RenderMap() const;
+
+    // Готовые компактные ответы Bus и Stop версии; строятся при первом обращении
+    [[nodiscard]] const ResponseFragments& GetResponseFragments() const;
+
+private:  // Fields
+    const uint64_t version_;
+    const serialization::TransportBase base_;
+    const routing::TransportRouter router_;
+
+    mutable std::once_flag map_flag_;
+    mutable std::unique_ptr<render::IncrementalMapRenderer> map_renderer_;
+    mutable std::atomic<bool> has_map_renderer_{false};  //> После true рендерер только читается
+
+    mutable std::once_flag fragments_flag_;
+    mutable std::optional<ResponseFragments> fragments_;
+};
+
+class SnapshotManager {
+public:  // Constructor
+    // prepare_responses - готовые ответы каждой версии строятся до её публикации, а не при первом запросе
+    explicit SnapshotManager(serialization::TransportBase base, bool prepare_responses = false);
+
+public:  // Methods
+    // Текущая версия. Читатели не ждут писателя: версия остаётся действительной, пока жив указатель
+    [[nodiscard]] std::shared_ptr<const CatalogueSnapshot> Acquire() const;
+
+    // Делает base следующей версией и возвращает её. Версия строится до замены указателя, поэтому
+    // читатели видят либо старую версию, либо новую целиком. Писатели выполняются по очереди
+    std::shared_ptr<const CatalogueSnapshot> Publish(serialization::TransportBase base);
+
+    // То же для базы, полученной из текущей версии пакетом изменений
+    std::shared_ptr<const CatalogueSnapshot> Publish(BaseUpdate update);
+
+private:  // Fields
+    const bool prepare_responses_;
+    std::mutex writer_mutex_;
+    std::shared_ptr<const CatalogueSnapshot> current_;  //> Доступ только через std::atomic_load/atomic_store
+};
+
+}  // namespace request
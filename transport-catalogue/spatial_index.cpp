@@ -0,0 +1,203 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <tuple>
+
+namespace geo {
+
+namespace {
+
+constexpr double kEarthRadius = 6371000.;
+constexpr double kDegreesToRadians = 3.1415926535 / 180.;
+constexpr double kMetresPerDegree = kEarthRadius * kDegreesToRadians;
+
+// В среднем столько точек приходится на одну ячейку сетки
+constexpr double kPointsPerCell = 2.;
+
+// Оценки расстояния по сетке занижаются с запасом, чтобы не отбросить точку из-за погрешности
+constexpr double kBoundSafety = 0.99;
+
+// Точки упорядочиваются по расстоянию, равноудалённые - по номеру
+struct MatchLess {
+    bool operator()(const GridIndex::Match& lhs, const GridIndex::Match& rhs) const {
+        return std::tie(lhs.distance, lhs.id) < std::tie(rhs.distance, rhs.id);
+    }
+};
+
+// Косинус наибольшей по модулю широты: во столько раз градус долготы там короче градуса широты
+double GetMinLatitudeCosine(double lat_first, double lat_second) {
+    const double max_abs_lat = std::min(90., std::max(std::abs(lat_first), std::abs(lat_second)));
+    return std::max(0., std::cos(max_abs_lat * kDegreesToRadians));
+}
+
+}  // namespace
+
+GridIndex::GridIndex(const std::vector<Coordinates>& points) {
+    if (points.empty())
+        return;
+
+    min_ = max_ = points.front();
+    for (const auto& point : points) {
+        min_.lat = std::min(min_.lat, point.lat);
+        min_.lng = std::min(min_.lng, point.lng);
+        max_.lat = std::max(max_.lat, point.lat);
+        max_.lng = std::max(max_.lng, point.lng);
+    }
+
+    // Шаг 1. Размер сетки: ячейки примерно квадратные на местности, в среднем kPointsPerCell точек на ячейку
+    const double height = std::max((max_.lat - min_.lat) * kMetresPerDegree, 1.);
+    const double width = std::max(
+        (max_.lng - min_.lng) * kMetresPerDegree * GetMinLatitudeCosine(min_.lat, max_.lat), 1.);
+    const double cells = std::max(1., static_cast<double>(points.size()) / kPointsPerCell);
+
+    columns_ = std::max(1, static_cast<int>(std::ceil(std::sqrt(cells * width / height))));
+    rows_ = std::max(1, static_cast<int>(std::ceil(cells / columns_)));
+
+    cell_lat_ = std::max((max_.lat - min_.lat) / rows_, 1e-12);
+    cell_lng_ = std::max((max_.lng - min_.lng) / columns_, 1e-12);
+
+    // Шаг 2. Сортировка подсчётом по номеру ячейки
+    std::vector<uint32_t> point_cells(points.size());
+    cell_offsets_.assign(static_cast<size_t>(rows_) * columns_ + 1, 0u);
+    for (size_t id = 0; id < points.size(); ++id) {
+        point_cells[id] = static_cast<uint32_t>(GetRow(points[id].lat) * columns_ + GetColumn(points[id].lng));
+        ++cell_offsets_[point_cells[id] + 1];
+    }
+    for (size_t cell = 1; cell < cell_offsets_.size(); ++cell)
+        cell_offsets_[cell] += cell_offsets_[cell - 1];
+
+    points_.resize(points.size());
+    ids_.resize(points.size());
+    std::vector<uint32_t> positions(cell_offsets_.begin(), std::prev(cell_offsets_.end()));
+    for (size_t id = 0; id < points.size(); ++id) {
+        const uint32_t position = positions[point_cells[id]]++;
+        points_[position] = points[id];
+        ids_[position] = static_cast<uint32_t>(id);
+    }
+}
+
+template <typename Func>
+void GridIndex::ForEachInCell(int row, int column, Func func) const {
+    const size_t cell = static_cast<size_t>(row) * columns_ + column;
+    for (uint32_t position = cell_offsets_[cell]; position < cell_offsets_[cell + 1]; ++position)
+        func(ids_[position], points_[position]);
+}
+
+size_t GridIndex::GetSize() const {
+    return points_.size();
+}
+
+std::vector<GridIndex::Match> GridIndex::FindInRadius(Coordinates center, double radius) const {
+    std::vector<Match> result;
+    if (points_.empty() || radius < 0.)
+        return result;
+
+    // Прямоугольник ячеек, покрывающий круг; долгота расширяется с учётом широты
+    const double delta_lat = radius / kMetresPerDegree;
+    const double cosine = GetMinLatitudeCosine(center.lat - delta_lat, center.lat + delta_lat) * kBoundSafety;
+
+    const int row_first = GetRow(center.lat - delta_lat);
+    const int row_last = GetRow(center.lat + delta_lat);
+    int column_first = 0;
+    int column_last = columns_ - 1;
+    if (cosine > 0.) {
+        const double delta_lng = delta_lat / cosine;
+        column_first = GetColumn(center.lng - delta_lng);
+        column_last = GetColumn(center.lng + delta_lng);
+    }
+
+    for (int row = row_first; row <= row_last; ++row) {
+        for (int column = column_first; column <= column_last; ++column) {
+            ForEachInCell(row, column, [&](uint32_t id, const Coordinates& point) {
+                if (const double distance = ComputeDistance(center, point); distance <= radius)
+                    result.push_back({id, distance});
+            });
+        }
+    }
+
+    std::sort(result.begin(), result.end(), MatchLess{});
+    return result;
+}
+
+std::vector<GridIndex::Match> GridIndex::FindNearest(Coordinates center, size_t count) const {
+    std::vector<Match> result;
+    if (points_.empty() || count == 0u)
+        return result;
+
+    // Лучшие найденные точки; на вершине - самая дальняя из них
+    std::priority_queue<Match, std::vector<Match>, MatchLess> best;
+
+    const int center_row = GetRow(center.lat);
+    const int center_column = GetColumn(center.lng);
+    const double cosine = GetMinLatitudeCosine(std::max(std::abs(min_.lat), std::abs(max_.lat)), center.lat);
+
+    auto visit = [&](uint32_t id, const Coordinates& point) {
+        const Match match{id, ComputeDistance(center, point)};
+        if (best.size() < count) {
+            best.push(match);
+        } else if (MatchLess{}(match, best.top())) {
+            best.pop();
+            best.push(match);
+        }
+    };
+
+    // Кольца ячеек вокруг ячейки центра: кольцо ring - ячейки на расстоянии ring по строкам или столбцам
+    for (int ring = 0;; ++ring) {
+        const int row_first = center_row - ring;
+        const int row_last = center_row + ring;
+        const int column_first = center_column - ring;
+        const int column_last = center_column + ring;
+
+        for (int row = std::max(row_first, 0); row <= std::min(row_last, rows_ - 1); ++row) {
+            const bool is_edge_row = (row == row_first || row == row_last);
+            for (int column = std::max(column_first, 0); column <= std::min(column_last, columns_ - 1); ++column) {
+                if (is_edge_row || column == column_first || column == column_last)
+                    ForEachInCell(row, column, visit);
+            }
+        }
+
+        const bool covers_rows = row_first <= 0 && row_last >= rows_ - 1;
+        const bool covers_columns = column_first <= 0 && column_last >= columns_ - 1;
+        if (covers_rows && covers_columns)
+            break;
+
+        // Любая непросмотренная точка лежит за границей просмотренного прямоугольника
+        if (best.size() == count) {
+            constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+            const double south = (row_first <= 0) ? kInfinity : center.lat - (min_.lat + row_first * cell_lat_);
+            const double north = (row_last >= rows_ - 1) ? kInfinity : min_.lat + (row_last + 1) * cell_lat_ - center.lat;
+            const double west =
+                (column_first <= 0) ? kInfinity : center.lng - (min_.lng + column_first * cell_lng_);
+            const double east =
+                (column_last >= columns_ - 1) ? kInfinity : min_.lng + (column_last + 1) * cell_lng_ - center.lng;
+
+            const double bound = std::min(std::min(south, north) * kMetresPerDegree,
+                                          std::min(west, east) * kMetresPerDegree * cosine) *
+                                 kBoundSafety;
+            if (best.top().distance <= bound)
+                break;
+        }
+    }
+
+    result.resize(best.size());
+    for (auto match = result.rbegin(); match != result.rend(); ++match) {
+        *match = best.top();
+        best.pop();
+    }
+    return result;
+}
+
+// Номер ячейки ограничивается сеткой до приведения к int, чтобы далёкие точки не переполняли его
+int GridIndex::GetRow(double lat) const {
+    return static_cast<int>(std::clamp(std::floor((lat - min_.lat) / cell_lat_), 0., rows_ - 1.));
+}
+
+int GridIndex::GetColumn(double lng) const {
+    return static_cast<int>(std::clamp(std::floor((lng - min_.lng) / cell_lng_), 0., columns_ - 1.));
+}
+
+}  // namespace geo
@@ -0,0 +1,58 @@
+#pragma once
+
+/*
+ * Описание: пространственный индекс точек на земной поверхности.
+ * Равномерная сетка по широте и долготе, точки каждой ячейки лежат в одном непрерывном массиве.
+ * Кандидаты отбираются по ячейкам, точное расстояние geo::ComputeDistance считается только для них.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "geo.h"
+
+namespace geo {
+
+class GridIndex {
+public:  // Types
+    struct Match {
+        uint32_t id{0u};        //> Номер точки в исходном массиве
+        double distance{0.};    //> Метры
+    };
+
+public:  // Constructors
+    GridIndex() = default;
+    explicit GridIndex(const std::vector<Coordinates>& points);
+
+public:  // Methods
+    [[nodiscard]] size_t GetSize() const;
+
+    // Все точки не дальше radius метров от center, по возрастанию расстояния
+    [[nodiscard]] std::vector<Match> FindInRadius(Coordinates center, double radius) const;
+
+    // count ближайших к center точек по возрастанию расстояния
+    [[nodiscard]] std::vector<Match> FindNearest(Coordinates center, size_t count) const;
+
+private:  // Methods
+    [[nodiscard]] int GetRow(double lat) const;
+    [[nodiscard]] int GetColumn(double lng) const;
+
+    // Вызывает func(id, point) для всех точек ячейки
+    template <typename Func>
+    void ForEachInCell(int row, int column, Func func) const;
+
+private:  // Fields
+    Coordinates min_{0., 0.};
+    Coordinates max_{0., 0.};
+
+    double cell_lat_{1.};
+    double cell_lng_{1.};
+    int rows_{0};
+    int columns_{0};
+
+    std::vector<uint32_t> cell_offsets_;  //> Точки ячейки: [cell_offsets_[cell], cell_offsets_[cell + 1])
+    std::vector<Coordinates> points_;
+    std::vector<uint32_t> ids_;
+};
+
+}  // namespace geo
@@ -1,6 +1,7 @@
 #define _USE_MATH_DEFINES
 #include "svg.h"
 
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 #include <string_view>
@@ -17,23 +18,24 @@ void ColorPrinter::operator()(const std::string& color) const {
 }
 
 void ColorPrinter::operator()(Rgb color) const {
+    // Компоненты выводятся как числа, без промежуточных строк std::to_string
     // clang-format off
-    os << "rgb("s
-       << std::to_string(color.red) << ","s
-       << std::to_string(color.green) << ","
-       << std::to_string(color.blue) << ")"s;
+    os << "rgb("sv
+       << static_cast<int>(color.red) << ','
+       << static_cast<int>(color.green) << ','
+       << static_cast<int>(color.blue) << ')';
     // clang-format on
 }
 
 void ColorPrinter::operator()(Rgba color) const {
     // clang-format off
-    os << "rgba("s
-       << std::to_string(color.red) << ","s
-       << std::to_string(color.green) << ","s
-       << std::to_string(color.blue) << ","s;
+    os << "rgba("sv
+       << static_cast<int>(color.red) << ','
+       << static_cast<int>(color.green) << ','
+       << static_cast<int>(color.blue) << ',';
     // clang-format on
 
-    os << color.opacity << ")"s;
+    os << color.opacity << ')';
 }
 
 std::ostream& operator<<(std::ostream& os, const Color& color) {
@@ -41,6 +43,15 @@ std::ostream& operator<<(std::ostream& os, const Color& color) {
     return os;
 }
 
+Color SerializeColor(const Color& color) {
+    if (std::holds_alternative<std::string>(color))
+        return color;
+
+    std::ostringstream out;
+    out << color;
+    return out.str();
+}
+
 std::ostream& operator<<(std::ostream& os, const StrokeLineCap& value) {
     switch (value) {
         case StrokeLineCap::BUTT:
@@ -105,6 +116,14 @@ Circle& Circle::SetRadius(double radius) {
     return *this;
 }
 
+Point Circle::GetCenter() const {
+    return center_;
+}
+
+double Circle::GetRadius() const {
+    return radius_;
+}
+
 void Circle::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
     out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
@@ -120,6 +139,10 @@ Polyline& Polyline::AddPoint(Point point) {
     return *this;
 }
 
+const std::vector<Point>& Polyline::GetPoints() const {
+    return vertexes_;
+}
+
 void Polyline::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
     out << "<polyline points=\"";
@@ -165,21 +188,43 @@ Text& Text::SetFontWeight(std::string font_weight) {
 
 Text& Text::SetData(std::string data) {
     text_ = std::move(data);
+    escaped_text_.reset();
     return *this;
 }
 
-std::string Text::PreprocessTest(const std::string& input_text) const {
-    std::string result = input_text;
+Text& Text::SetEscapedData(std::string_view escaped_data) {
+    text_.clear();
+    escaped_text_ = escaped_data;
+    return *this;
+}
 
-    for (const auto& pair : kEscapeCharacters) {
-        size_t position{0};
-        while (true) {
-            position = result.find(pair.character, position);
-            if (position == std::string::npos)
-                break;
-            result.replace(position, 1, pair.replacement);
-            position = position + pair.replacement.size();
-        }
+Point Text::GetPosition() const {
+    return position_;
+}
+
+Point Text::GetOffset() const {
+    return offset_;
+}
+
+std::optional<uint32_t> Text::GetFontSize() const {
+    return font_size_;
+}
+
+std::string Text::GetEscapedData() const {
+    return escaped_text_ ? std::string(*escaped_text_) : Escape(text_);
+}
+
+std::string Text::Escape(std::string_view input_text) {
+    std::string result;
+    result.reserve(input_text.size());
+
+    for (char character : input_text) {
+        auto replacement = std::find_if(kEscapeCharacters.begin(), kEscapeCharacters.end(),
+                                        [character](const auto& pair) { return pair.character == character; });
+        if (replacement == kEscapeCharacters.end())
+            result.push_back(character);
+        else
+            result += replacement->replacement;
     }
 
     return result;
@@ -196,13 +241,31 @@ void Text::RenderObject(const RenderContext& context) const {
     out << "dx=\""sv << offset_.x << "\" dy=\"" << offset_.y << "\""sv;
 
     // Styling attributes
-    out << " font-size=\"" << font_size_ << "\"";
+    if (font_size_)
+        out << " font-size=\"" << *font_size_ << "\"";
     if (!font_family_.empty())
         out << " font-family=\"" << font_family_ << "\"";
     if (!font_weight_.empty())
         out << " font-weight=\"" << font_weight_ << "\"";
 
-    out << ">" << PreprocessTest(text_) << "</text>";
+    out << ">";
+    if (escaped_text_)
+        out << *escaped_text_;
+    else
+        out << Escape(text_);
+    out << "</text>";
+}
+
+/* ---------------- ESCAPED TEXT CACHE ---------------- */
+
+std::string_view EscapedTextCache::Get(std::string_view text) {
+    std::lock_guard guard(mutex_);
+
+    // Строка ключа создаётся только при первой вставке; найденная позиция служит подсказкой для неё
+    auto position = escaped_.lower_bound(text);
+    if (position == escaped_.end() || position->first != text)
+        position = escaped_.emplace_hint(position, text, Text::Escape(text));
+    return position->second;
 }
 
 /* ---------------- OBJECT CONTAINER ---------------- */
@@ -213,13 +276,27 @@ void Document::AddPtr(std::unique_ptr<Object>&& object) {
     storage_.emplace_back(std::move(object));
 }
 
+void Document::SetStyleSheet(std::string style_sheet) {
+    style_sheet_ = std::move(style_sheet);
+}
+
 void Document::Render(std::ostream& out) const {
     // RenderContext context(out, 2, 2);
 
-    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
-    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
+    RenderPrologue(out, style_sheet_);
     for (const auto& object : storage_)
         object->Render(out);
+    RenderEpilogue(out);
+}
+
+void Document::RenderPrologue(std::ostream& out, std::string_view style_sheet) {
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
+    if (!style_sheet.empty())
+        out << "  <style>"sv << style_sheet << "</style>"sv << std::endl;
+}
+
+void Document::RenderEpilogue(std::ostream& out) {
     out << "</svg>"sv;
 }
 
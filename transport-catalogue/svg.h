@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -80,6 +81,9 @@ struct ColorPrinter {
 
 std::ostream& operator<<(std::ostream& os, const Color& color);
 
+// Заранее сериализует цвет в строку: такой цвет выводится без повторного форматирования компонент
+[[nodiscard]] Color SerializeColor(const Color& color);
+
 enum class StrokeLineCap {
     BUTT,
     ROUND,
@@ -145,6 +149,22 @@ public:  // Methods
         return AsObjectType();
     }
 
+    // Задаёт CSS-классы объекта (атрибут class), стили которых описаны в <style> документа
+    ObjectType& SetClass(std::string class_name) {
+        class_name_ = std::move(class_name);
+        return AsObjectType();
+    }
+
+    [[nodiscard]] const std::optional<Color>& GetFillColor() const {
+        return color_;
+    }
+    [[nodiscard]] const std::optional<Color>& GetStrokeColor() const {
+        return stroke_color_;
+    }
+    [[nodiscard]] const std::optional<double>& GetStrokeWidth() const {
+        return stroke_width_;
+    }
+
 protected:  // Destructor
     ~PathProps() = default;
 
@@ -154,6 +174,7 @@ protected:  // Methods
 
         //По умолчанию мы предполагаем, что объявление примитивов имеет пробел в конце
 
+        PrintProperty(os, "class"sv, class_name_);
         PrintProperty(os, "fill"sv, color_);
         PrintProperty(os, "stroke"sv, stroke_color_);
         PrintProperty(os, "stroke-width"sv, stroke_width_);
@@ -171,6 +192,7 @@ protected:  // Fields
     std::optional<double> stroke_width_;
     std::optional<StrokeLineCap> line_cap_;
     std::optional<StrokeLineJoin> line_join_;
+    std::optional<std::string> class_name_;
 
 private:  // Methods
     ObjectType& AsObjectType() {
@@ -194,6 +216,9 @@ public:  // Methods
     Circle& SetCenter(Point center);
     Circle& SetRadius(double radius);
 
+    [[nodiscard]] Point GetCenter() const;
+    [[nodiscard]] double GetRadius() const;
+
 private:  // Methods
     void RenderObject(const RenderContext& context) const override;
 
@@ -210,6 +235,8 @@ class Polyline final : public Object, public PathProps<Polyline> {
 public:  // Methods
     Polyline& AddPoint(Point point);
 
+    [[nodiscard]] const std::vector<Point>& GetPoints() const;
+
 private:  // Methods
     void RenderObject(const RenderContext& context) const override;
 
@@ -246,15 +273,23 @@ public:  // Methods
     // Задаёт текстовое содержимое объекта (отображается внутри тега text)
     Text& SetData(std::string data);
 
+    // Задаёт уже экранированное содержимое без копирования: строка должна жить до вывода документа
+    Text& SetEscapedData(std::string_view escaped_data);
+
+    [[nodiscard]] Point GetPosition() const;
+    [[nodiscard]] Point GetOffset() const;
+    [[nodiscard]] std::optional<uint32_t> GetFontSize() const;
+
+    // Содержимое в том виде, в котором оно выводится в документ (с экранированными символами)
+    [[nodiscard]] std::string GetEscapedData() const;
+
+    //! Заменяет все escape-символы SVG для входной строки за один проход
+    [[nodiscard]] static std::string Escape(std::string_view input_text);
+
 private:  // Methods
     void RenderObject(const RenderContext& context) const override;
 
-    //! Заменяет все escape-символы SVG для входной строки
-    [[nodiscard]] std::string PreprocessTest(const std::string& input_text) const;
-
 private:  // Constants
-    //! Последовательность символов должна начинаться с «&», иначе
-    //! все следующие символы (&quot, ...) будут с заменой '&'
     inline static const std::vector<EscapeCharacter> kEscapeCharacters{
         {'&', "&amp;"}, {'"', "&quot;"}, {'\'', "&apos;"}, {'<', "&lt;"}, {'>', "&gt;"}};
 
@@ -262,11 +297,25 @@ private:  // Fields
     Point position_;
     Point offset_;
 
-    uint32_t font_size_{1};
+    std::optional<uint32_t> font_size_;
     std::string font_family_;
     std::string font_weight_;
 
     std::string text_;
+    std::optional<std::string_view> escaped_text_;
+};
+
+/*
+ * Хранит экранированные версии строк, чтобы каждая строка экранировалась один раз при первом использовании.
+ * Возвращаемые string_view остаются валидными, пока жив кэш: узлы std::map не перемещаются.
+ */
+class EscapedTextCache {
+public:  // Methods
+    [[nodiscard]] std::string_view Get(std::string_view text);
+
+private:  // Fields
+    std::mutex mutex_;
+    std::map<std::string, std::string, std::less<>> escaped_;  //> Поиск по string_view без временной строки
 };
 
 /* ---------------- OBJECT CONTAINERS ---------------- */
@@ -291,6 +340,16 @@ class Document final : public ObjectContainer {
 public:  // Methods
     void AddPtr(std::unique_ptr<Object>&& object) override;
     void Render(std::ostream& out) const;
+
+    // Задаёт содержимое блока <style>, который выводится перед всеми объектами документа
+    void SetStyleSheet(std::string style_sheet);
+
+    // Вывод заголовка и окончания документа: позволяет собрать SVG из заранее отрисованных объектов
+    static void RenderPrologue(std::ostream& out, std::string_view style_sheet);
+    static void RenderEpilogue(std::ostream& out);
+
+private:  // Fields
+    std::string style_sheet_;
 };
 
 /* ---------------- FIGURES ---------------- */
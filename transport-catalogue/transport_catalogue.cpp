@@ -1,10 +1,74 @@
 #include "transport_catalogue.h"
 
-#include <execution>
+#include <algorithm>
+#include <cmath>
 #include <numeric>
+#include <stdexcept>
+
+#include "log_duration.h"
+#include "parallel.h"
 
 namespace catalogue {
 
+namespace {
+
+// Названия с общим префиксом в отсортированном массиве идут подряд, начиная с lower_bound(prefix)
+std::vector<std::string_view> FindByPrefix(const std::vector<std::string_view>& sorted_names, std::string_view prefix,
+                                           size_t limit) {
+    std::vector<std::string_view> result;
+
+    for (auto name = std::lower_bound(sorted_names.begin(), sorted_names.end(), prefix);
+         name != sorted_names.end() && result.size() < limit && name->substr(0, prefix.size()) == prefix; ++name)
+        result.emplace_back(*name);
+
+    return result;
+}
+
+// Наименьшее число пролётов to - from среди пар позиций from < to; позиции в обоих отрезках по возрастанию.
+// Остановка обычно встречается на маршруте один-два раза, поэтому проверка направления почти O(1)
+std::optional<int> CountSpans(const uint32_t* from_first, const uint32_t* from_last, const uint32_t* to_first,
+                              const uint32_t* to_last) {
+    std::optional<int> result;
+
+    const uint32_t* from = from_first;
+    for (const uint32_t* to = to_first; to != to_last; ++to) {
+        // Перед from остаются позиции меньше *to, ближайшая из них - последняя
+        while (from != from_last && *from < *to)
+            ++from;
+        if (from != from_first) {
+            const int spans = static_cast<int>(*to - *std::prev(from));
+            if (!result || spans < *result)
+                result = spans;
+        }
+    }
+
+    return result;
+}
+
+constexpr size_t kBusStatisticsFieldCount = 4u;
+
+// Значение поля как число; NaN (кривизна маршрута из одной точки) считается наименьшим значением
+double GetFieldValue(const BusStatistics& statistics, BusStatisticsField field) {
+    double value = 0.;
+    switch (field) {
+        case BusStatisticsField::ROUTE_LENGTH:
+            value = statistics.rout_length;
+            break;
+        case BusStatisticsField::CURVATURE:
+            value = statistics.curvature;
+            break;
+        case BusStatisticsField::STOPS_COUNT:
+            value = static_cast<double>(statistics.stops_count);
+            break;
+        case BusStatisticsField::UNIQUE_STOPS_COUNT:
+            value = static_cast<double>(statistics.unique_stops_count);
+            break;
+    }
+    return std::isnan(value) ? -std::numeric_limits<double>::infinity() : value;
+}
+
+}  // namespace
+
 void TransportCatalogue::AddStop(Stop stop) {
     // Add stop logic
     const auto position = stops_storage_.insert(stops_storage_.begin(), std::move(stop));
@@ -13,14 +77,260 @@ void TransportCatalogue::AddStop(Stop stop) {
     //  При вычислении коэффициентов масштабирования карты должны учитываться только те остановки, которые
     // входят в какой-либо маршрут. Остановки, которые не входят ни в один из маршрутов, учитываться не должны.
     buses_through_stop_.insert({position->name, {}});
+
+    is_frozen_ = false;
 }
 
 void TransportCatalogue::AddDistance(std::string_view stop_from, std::string_view stop_to, int distance) {
     //! На этом шаге мы предполагаем, что проанализированы ВСЕ остановки.
-    distances_between_stops_.insert({{stops_.at(stop_from), stops_.at(stop_to)}, distance});
+    distances_between_stops_.insert_or_assign({stops_.at(stop_from), stops_.at(stop_to)}, distance);
+
+    // Расстояние входит в длину маршрутов обеих остановок
+    InvalidateBusStatistics(stop_from);
+    InvalidateBusStatistics(stop_to);
+
+    is_frozen_ = false;
+}
+
+bool TransportCatalogue::RemoveBus(std::string_view bus_name) {
+    const auto position = buses_.find(bus_name);
+    if (position == buses_.end())
+        return false;
+
+    for (std::string_view stop : position->second->stop_names)
+        buses_through_stop_.at(stop).erase(position->first);
+    ordered_bus_list_.erase(position->first);
+    bus_statistics_cache_.erase(position->first);
+    buses_.erase(position);
+
+    ++tombstone_count_;
+    coordinates_outdated_ = true;
+    is_frozen_ = false;
+    return true;
+}
+
+bool TransportCatalogue::RemoveStop(std::string_view stop_name) {
+    using namespace std::literals;
+
+    const auto position = stops_.find(stop_name);
+    if (position == stops_.end())
+        return false;
+    if (!buses_through_stop_.at(position->first).empty())
+        throw std::invalid_argument("Stop is used by bus routes: "s + std::string(stop_name));
+
+    buses_through_stop_.erase(position->first);
+    stops_.erase(position);
+
+    ++tombstone_count_;
+    is_frozen_ = false;
+    return true;
+}
+
+TransportCatalogue TransportCatalogue::Compact() const {
+    LOG_DURATION("Catalogue compaction");
+
+    TransportCatalogue result;
+
+    // Хранилища заполняются с начала, поэтому объекты добавляются с конца - в исходном порядке.
+    // Живой объект - тот, на чьё название ссылается ключ словаря
+    for (auto stop = stops_storage_.rbegin(); stop != stops_storage_.rend(); ++stop) {
+        const auto position = stops_.find(stop->name);
+        if (position != stops_.end() && position->first.data() == stop->name.data())
+            result.AddStop(*stop);
+    }
+
+    ForEachDistance([&result](const Stop& from, const Stop& to, int distance) {
+        result.AddDistance(from.name, to.name, distance);
+    });
+
+    for (auto bus = buses_storage_.rbegin(); bus != buses_storage_.rend(); ++bus) {
+        const auto position = buses_.find(bus->number);
+        if (position != buses_.end() && position->first.data() == bus->number.data())
+            result.AddBus(*bus);
+    }
+
+    // Статистика ссылается на номер автобуса, поэтому номер заменяется номером из копии
+    for (const auto& [bus_name, statistics] : bus_statistics_cache_) {
+        const auto position = result.buses_.find(bus_name);
+        auto& copied_statistics = result.bus_statistics_cache_[position->first] = statistics;
+        copied_statistics.number = position->second->number;
+    }
+
+    return result;
+}
+
+void TransportCatalogue::InvalidateBusStatistics(std::string_view stop_name) {
+    if (bus_statistics_cache_.empty())
+        return;
+    for (std::string_view bus : buses_through_stop_.at(stop_name))
+        bus_statistics_cache_.erase(bus);
+}
+
+bool TransportCatalogue::IsLiveStop(const std::shared_ptr<Stop>& stop) const {
+    const auto position = stops_.find(stop->name);
+    return position != stops_.end() && position->second == stop;
+}
+
+void TransportCatalogue::Freeze() {
+    LOG_DURATION("Catalogue freeze");
+
+    // Шаг 0. После удаления автобусов границы координат считаются заново по оставшимся маршрутам
+    if (coordinates_outdated_) {
+        coordinates_min_ = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+        coordinates_max_ = {std::numeric_limits<double>::min(), std::numeric_limits<double>::min()};
+        for (const auto& [_, bus] : buses_) {
+            for (std::string_view stop : bus->stop_names)
+                UpdateMinMaxStopCoordinates(stops_.at(stop)->point);
+        }
+        coordinates_outdated_ = false;
+    }
+
+    // Шаг 1. Остановки в алфавитном порядке: так результаты поиска не зависят от порядка загрузки
+    frozen_stops_.clear();
+    frozen_stops_.reserve(stops_.size());
+    for (const auto& [_, stop] : stops_)
+        frozen_stops_.emplace_back(stop);
+    std::sort(frozen_stops_.begin(), frozen_stops_.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs->name < rhs->name; });
+
+    // Шаг 2. Отсортированные массивы названий для поиска по префиксу и номера остановок и автобусов
+    frozen_stop_names_.clear();
+    frozen_stop_names_.reserve(frozen_stops_.size());
+    frozen_stop_ids_.clear();
+    for (const auto& stop : frozen_stops_) {
+        frozen_stop_ids_.emplace(stop->name, static_cast<uint32_t>(frozen_stop_names_.size()));
+        frozen_stop_names_.emplace_back(stop->name);
+    }
+
+    frozen_bus_names_.assign(ordered_bus_list_.begin(), ordered_bus_list_.end());
+    frozen_buses_.clear();
+    frozen_buses_.reserve(frozen_bus_names_.size());
+    for (std::string_view bus_name : frozen_bus_names_)
+        frozen_buses_.emplace_back(buses_.at(bus_name));
+
+    // Шаг 3. Независимые индексы строятся параллельно
+    parallel::InvokeAll(
+        // Пространственный индекс по координатам остановок
+        [this] {
+            std::vector<geo::Coordinates> points;
+            points.reserve(frozen_stops_.size());
+            for (const auto& stop : frozen_stops_)
+                points.emplace_back(stop->point);
+            stops_index_ = geo::GridIndex(points);
+        },
+        // Индекс триграмм названий остановок для нечёткого поиска
+        [this] { stop_names_index_ = text::TrigramIndex(frozen_stop_names_); },
+        // Битовые маски автобусов каждой остановки и позиции остановок на маршрутах
+        [this] {
+            constexpr size_t kMaskWordBits = 64u;
+            bus_mask_words_ = (frozen_buses_.size() + kMaskWordBits - 1) / kMaskWordBits;
+            stop_bus_masks_.assign(frozen_stops_.size() * bus_mask_words_, 0u);
+
+            // Вхождения остановок в маршруты идут по возрастанию номера автобуса и позиции
+            struct Occurrence {
+                uint32_t stop_id;
+                uint32_t bus_id;
+                uint32_t position;
+            };
+            std::vector<Occurrence> occurrences;
+            std::vector<uint32_t> stop_offsets(frozen_stops_.size() + 1, 0u);
+
+            for (size_t bus_id = 0; bus_id < frozen_buses_.size(); ++bus_id) {
+                uint32_t position = 0u;
+                for (std::string_view stop : frozen_buses_[bus_id]->stop_names) {
+                    const uint32_t stop_id = frozen_stop_ids_.at(stop);
+                    occurrences.push_back({stop_id, static_cast<uint32_t>(bus_id), position++});
+                    ++stop_offsets[stop_id + 1];
+                    stop_bus_masks_[stop_id * bus_mask_words_ + bus_id / kMaskWordBits] |=
+                        uint64_t{1} << (bus_id % kMaskWordBits);
+                }
+            }
+
+            // Устойчивая сортировка подсчётом по остановке сохраняет порядок автобусов и позиций
+            std::partial_sum(stop_offsets.begin(), stop_offsets.end(), stop_offsets.begin());
+            std::vector<Occurrence> stop_occurrences(occurrences.size());
+            auto next_offsets = stop_offsets;
+            for (const auto& occurrence : occurrences)
+                stop_occurrences[next_offsets[occurrence.stop_id]++] = occurrence;
+
+            stop_route_offsets_.assign(frozen_stops_.size() + 1, 0u);
+            stop_routes_.clear();
+            stop_route_positions_.clear();
+            stop_route_positions_.reserve(stop_occurrences.size());
+            for (size_t stop_id = 0; stop_id < frozen_stops_.size(); ++stop_id) {
+                stop_route_offsets_[stop_id] = static_cast<uint32_t>(stop_routes_.size());
+                for (uint32_t index = stop_offsets[stop_id]; index < stop_offsets[stop_id + 1]; ++index) {
+                    const auto& occurrence = stop_occurrences[index];
+                    if (stop_routes_.size() == stop_route_offsets_[stop_id] ||
+                        stop_routes_.back().bus_id != occurrence.bus_id)
+                        stop_routes_.push_back({occurrence.bus_id, static_cast<uint32_t>(stop_route_positions_.size()), 0u});
+                    stop_route_positions_.push_back(occurrence.position);
+                    ++stop_routes_.back().position_count;
+                }
+            }
+            stop_route_offsets_.back() = static_cast<uint32_t>(stop_routes_.size());
+        },
+        // Статистика автобусов: посчитанная при прошлой заморозке берётся из кэша,
+        // остальные маршруты считаются независимо друг от друга
+        [this] {
+            frozen_bus_statistics_.assign(frozen_buses_.size(), {});
+            frozen_bus_statistics_missing_.assign(frozen_buses_.size(), 0u);
+            std::vector<size_t> outdated_ids;
+            for (size_t id = 0; id < frozen_buses_.size(); ++id) {
+                if (const auto position = bus_statistics_cache_.find(frozen_bus_names_[id]);
+                    position != bus_statistics_cache_.end()) {
+                    frozen_bus_statistics_[id] = position->second;
+                } else {
+                    outdated_ids.push_back(id);
+                }
+            }
+            LOG_HIT_RATE("Bus statistics cache", frozen_buses_.size() - outdated_ids.size(), frozen_buses_.size());
+
+            // Маршрут без расстояния между соседними остановками не мешает остальным: его статистика
+            // считается при запросе и бросает исключение там же, где и без предварительного расчёта
+            parallel::ForEachIndex(outdated_ids.size(), parallel::GetDefaultThreadCount(), [&](size_t index, size_t) {
+                const size_t id = outdated_ids[index];
+                try {
+                    frozen_bus_statistics_[id] = ComputeBusStatistics(frozen_buses_[id]);
+                } catch (const std::out_of_range&) {
+                    frozen_bus_statistics_missing_[id] = 1u;
+                }
+            });
+            for (size_t id : outdated_ids) {
+                if (!frozen_bus_statistics_missing_[id])
+                    bus_statistics_cache_.emplace(frozen_bus_names_[id], frozen_bus_statistics_[id]);
+            }
+        });
+
+    // Шаг 4. Отсортированные по полям статистики индексы; автобусы без статистики в них не входят.
+    // Номера автобусов идут по алфавиту, поэтому устойчивая сортировка упорядочивает равные значения по названию
+    std::vector<uint32_t> ranked_ids;
+    ranked_ids.reserve(frozen_bus_statistics_.size());
+    for (uint32_t id = 0; id < frozen_bus_statistics_.size(); ++id) {
+        if (!frozen_bus_statistics_missing_[id])
+            ranked_ids.push_back(id);
+    }
+
+    bus_statistics_indexes_.assign(kBusStatisticsFieldCount, {});
+    parallel::ForEachIndex(kBusStatisticsFieldCount, parallel::GetDefaultThreadCount(), [&](size_t field, size_t) {
+        auto& index = bus_statistics_indexes_[field];
+        index = ranked_ids;
+        std::stable_sort(index.begin(), index.end(), [this, field](uint32_t lhs, uint32_t rhs) {
+            return GetFieldValue(frozen_bus_statistics_[lhs], static_cast<BusStatisticsField>(field)) <
+                   GetFieldValue(frozen_bus_statistics_[rhs], static_cast<BusStatisticsField>(field));
+        });
+    });
+
+    is_frozen_ = true;
+}
+
+bool TransportCatalogue::IsFrozen() const {
+    return is_frozen_;
 }
 
 void TransportCatalogue::AddBus(Bus bus) {
+    RemoveBus(bus.number);
+
     //! На этом шаге мы предполагаем, что проанализированы ВСЕ остановки.
     for (auto& stop : bus.stop_names) {
         stop = stops_.find(stop)->first;
@@ -35,31 +345,61 @@ void TransportCatalogue::AddBus(Bus bus) {
     // Add stop for <stop-bus> correspondence
     for (std::string_view stop : position->stop_names)
         buses_through_stop_[stop].insert(position->number);
+
+    is_frozen_ = false;
 }
 
 std::optional<BusStatistics> TransportCatalogue::GetBusStatistics(std::string_view bus_number) const {
+    // После заморозки статистика уже посчитана
+    if (is_frozen_) {
+        const auto position = std::lower_bound(frozen_bus_names_.begin(), frozen_bus_names_.end(), bus_number);
+        if (position == frozen_bus_names_.end() || *position != bus_number)
+            return std::nullopt;
+        const size_t id = position - frozen_bus_names_.begin();
+        if (frozen_bus_statistics_missing_[id])
+            return ComputeBusStatistics(frozen_buses_[id]);
+        return frozen_bus_statistics_[id];
+    }
+
     if (buses_.count(bus_number) == 0)
         return std::nullopt;
 
-    auto bus_info = buses_.at(bus_number);
+    return ComputeBusStatistics(buses_.at(bus_number));
+}
 
+BusStatistics TransportCatalogue::ComputeBusStatistics(const std::shared_ptr<Bus>& bus_info) const {
     BusStatistics result;
     result.number = bus_info->number;
+
+    // У маршрута без остановок вся статистика нулевая
+    if (bus_info->stop_names.empty())
+        return result;
+
     result.stops_count = bus_info->GetStopsCount();
     result.unique_stops_count = bus_info->unique_stops.size();
     result.rout_length = AllRouteLen(bus_info);
-    result.curvature = static_cast<double>(result.rout_length) / GeoLenCal(bus_info);
+
+    // Маршрут из одной точки не имеет длины, извилистость для него не определена
+    const double geographic_length = GeoLenCal(bus_info);
+    result.curvature = (geographic_length > 0.) ? static_cast<double>(result.rout_length) / geographic_length : 0.;
 
     return result;
 }
 
+int TransportCatalogue::GetDistance(std::string_view stop_from, std::string_view stop_to) const {
+    auto key = std::make_pair(stops_.at(stop_from), stops_.at(stop_to));
+    // Если мы не нашли «от -> до», то ищем «до -> от»
+    if (const auto position = distances_between_stops_.find(key); position != distances_between_stops_.end())
+        return position->second;
+    return distances_between_stops_.at({key.second, key.first});
+}
+
 int TransportCatalogue::AllRouteLen(const std::shared_ptr<Bus>& bus_info) const {
+    if (bus_info->stop_names.size() < 2u)
+        return 0;
+
     auto get_route_length = [this](std::string_view from, std::string_view to) {
-        auto key = std::make_pair(stops_.at(from), stops_.at(to));
-        // Если мы не нашли «от -> до», то ищем «до -> от»
-        return (distances_between_stops_.count(key) > 0)
-                   ? distances_between_stops_.at(key)
-                   : distances_between_stops_.at({stops_.at(to), stops_.at(from)});
+        return GetDistance(from, to);
     };
 
     int forward_route = 
@@ -75,6 +415,9 @@ int TransportCatalogue::AllRouteLen(const std::shared_ptr<Bus>& bus_info) const
 }
 /*функция перебирает названия остановок в bus_info и вычисляет географическую длину путем суммирования расстояний между последовательными остановками */
 double TransportCatalogue::GeoLenCal(const std::shared_ptr<Bus>& bus_info) const {
+    if (bus_info->stop_names.size() < 2u)
+        return 0.;
+
     double geographic_length = std::transform_reduce(
         std::next(bus_info->stop_names.begin()), bus_info->stop_names.end(), bus_info->stop_names.begin(), 0.,
         std::plus<>(), [this](std::string_view from, std::string_view to) {
@@ -137,7 +480,7 @@ BusStopsStorage TransportCatalogue::GetRouteInfo(std::string_view bus_name, bool
         stops.emplace_back(stops_.at(stop));
 
     // Backward way
-    if (include_backward_way && bus->type == catalogue::RouteType::TWO_DIRECTIONAL) {
+    if (include_backward_way && bus->type == catalogue::RouteType::TWO_DIRECTIONAL && !bus->stop_names.empty()) {
         for (auto stop = std::next(bus->stop_names.rbegin()); stop != bus->stop_names.rend(); ++stop)
             stops.emplace_back(stops_.at(*stop));
     }
@@ -160,6 +503,18 @@ StopsStorage TransportCatalogue::GetAllStopsFromRoutes() const {
     return {stops.begin(), stops.end()};
 }
 
+std::shared_ptr<Stop> TransportCatalogue::GetStop(std::string_view stop_name) const {
+    if (const auto position = stops_.find(stop_name); position != stops_.end())
+        return position->second;
+    return nullptr;
+}
+
+std::shared_ptr<Bus> TransportCatalogue::GetBus(std::string_view bus_name) const {
+    if (const auto position = buses_.find(bus_name); position != buses_.end())
+        return position->second;
+    return nullptr;
+}
+
 std::unique_ptr<std::set<std::string_view>> TransportCatalogue::GetBusStop(
     std::string_view stop_name) const {
     if (const auto position = buses_through_stop_.find(stop_name); position != buses_through_stop_.end())
@@ -167,4 +522,151 @@ std::unique_ptr<std::set<std::string_view>> TransportCatalogue::GetBusStop(
     return nullptr;
 }
 
+std::vector<NearbyStop> TransportCatalogue::FindStopsInRadius(const geo::Coordinates& center, double radius) const {
+    CheckFrozen();
+    return MakeNearbyStops(stops_index_.FindInRadius(center, radius));
+}
+
+std::vector<NearbyStop> TransportCatalogue::FindNearestStops(const geo::Coordinates& center, size_t count) const {
+    CheckFrozen();
+    return MakeNearbyStops(stops_index_.FindNearest(center, count));
+}
+
+const std::vector<std::shared_ptr<Stop>>& TransportCatalogue::GetSortedStops() const {
+    CheckFrozen();
+    return frozen_stops_;
+}
+
+std::vector<std::string_view> TransportCatalogue::FindStopsByPrefix(std::string_view prefix, size_t limit) const {
+    CheckFrozen();
+    return FindByPrefix(frozen_stop_names_, prefix, limit);
+}
+
+std::vector<std::string_view> TransportCatalogue::FindBusesByPrefix(std::string_view prefix, size_t limit) const {
+    CheckFrozen();
+    return FindByPrefix(frozen_bus_names_, prefix, limit);
+}
+
+std::vector<BusStatistics> TransportCatalogue::GetTopBuses(BusStatisticsField field, size_t count) const {
+    CheckFrozen();
+
+    // Индекс отсортирован по возрастанию, поэтому наибольшие значения - с конца, а равные идут по алфавиту
+    const auto& index = bus_statistics_indexes_[static_cast<size_t>(field)];
+    std::vector<BusStatistics> result;
+    result.reserve(std::min(count, index.size()));
+
+    for (auto group_end = index.end(); group_end != index.begin() && result.size() < count;) {
+        const double value = GetFieldValue(frozen_bus_statistics_[*std::prev(group_end)], field);
+        auto group_begin = std::prev(group_end);
+        while (group_begin != index.begin() &&
+               GetFieldValue(frozen_bus_statistics_[*std::prev(group_begin)], field) == value)
+            --group_begin;
+
+        for (auto id = group_begin; id != group_end && result.size() < count; ++id)
+            result.push_back(frozen_bus_statistics_[*id]);
+        group_end = group_begin;
+    }
+
+    return result;
+}
+
+std::vector<BusStatistics> TransportCatalogue::GetBusesInRange(BusStatisticsField field, double min_value,
+                                                               double max_value) const {
+    CheckFrozen();
+
+    const auto& index = bus_statistics_indexes_[static_cast<size_t>(field)];
+    const auto first = std::partition_point(index.begin(), index.end(), [&](uint32_t id) {
+        return GetFieldValue(frozen_bus_statistics_[id], field) < min_value;
+    });
+    const auto last = std::partition_point(first, index.end(), [&](uint32_t id) {
+        return GetFieldValue(frozen_bus_statistics_[id], field) <= max_value;
+    });
+
+    std::vector<BusStatistics> result;
+    result.reserve(last - first);
+    for (auto id = first; id != last; ++id)
+        result.push_back(frozen_bus_statistics_[*id]);
+    return result;
+}
+
+std::optional<std::vector<BusConnection>> TransportCatalogue::FindConnections(std::string_view from,
+                                                                              std::string_view to) const {
+    CheckFrozen();
+
+    const auto from_id = frozen_stop_ids_.find(from);
+    const auto to_id = frozen_stop_ids_.find(to);
+    if (from_id == frozen_stop_ids_.end() || to_id == frozen_stop_ids_.end())
+        return std::nullopt;
+
+    const uint64_t* from_mask = stop_bus_masks_.data() + from_id->second * bus_mask_words_;
+    const uint64_t* to_mask = stop_bus_masks_.data() + to_id->second * bus_mask_words_;
+
+    // Записи остановок по возрастанию номера автобуса: общие автобусы из масок идут в том же порядке,
+    // поэтому курсоры по записям двигаются только вперёд
+    const auto* from_route = stop_routes_.data() + stop_route_offsets_[from_id->second];
+    const auto* from_routes_end = stop_routes_.data() + stop_route_offsets_[from_id->second + 1];
+    const auto* to_route = stop_routes_.data() + stop_route_offsets_[to_id->second];
+    const auto* to_routes_end = stop_routes_.data() + stop_route_offsets_[to_id->second + 1];
+    const auto find_route = [](const StopRoute* first, const StopRoute* last, size_t bus_id) {
+        return std::lower_bound(first, last, bus_id,
+                                [](const StopRoute& route, size_t id) { return route.bus_id < id; });
+    };
+    const auto positions = [this](const StopRoute& route) {
+        const uint32_t* first = stop_route_positions_.data() + route.first_position;
+        return std::make_pair(first, first + route.position_count);
+    };
+
+    // Пересечение масок обычными 64-битными словами даёт автобусы через обе остановки; направление
+    // проверяется только для них по заранее записанным позициям остановок на маршруте
+    std::vector<BusConnection> result;
+    for (size_t word = 0; word < bus_mask_words_; ++word) {
+        for (uint64_t common = from_mask[word] & to_mask[word]; common != 0u; common &= common - 1u) {
+            const size_t bus_id = word * 64u + static_cast<size_t>(__builtin_ctzll(common));
+            from_route = find_route(from_route, from_routes_end, bus_id);
+            to_route = find_route(to_route, to_routes_end, bus_id);
+            const auto [from_first, from_last] = positions(*from_route);
+            const auto [to_first, to_last] = positions(*to_route);
+
+            // Некольцевой маршрут проходится и в обратном направлении: там from стоит после to
+            auto spans = CountSpans(from_first, from_last, to_first, to_last);
+            if (frozen_buses_[bus_id]->type == RouteType::TWO_DIRECTIONAL) {
+                const auto backward_spans = CountSpans(to_first, to_last, from_first, from_last);
+                if (backward_spans && (!spans || *backward_spans < *spans))
+                    spans = backward_spans;
+            }
+
+            if (spans)
+                result.push_back({frozen_buses_[bus_id], *spans});
+        }
+    }
+
+    return result;
+}
+
+std::vector<SimilarStop> TransportCatalogue::FindSimilarStops(std::string_view name, size_t limit,
+                                                              double min_similarity) const {
+    CheckFrozen();
+
+    std::vector<SimilarStop> result;
+    for (const auto& match : stop_names_index_.FindSimilar(name, limit, min_similarity))
+        result.push_back({frozen_stops_[match.id], match.similarity});
+    return result;
+}
+
+void TransportCatalogue::CheckFrozen() const {
+    using namespace std::literals;
+    if (!is_frozen_)
+        throw std::logic_error("Catalogue must be frozen before search queries"s);
+}
+
+std::vector<NearbyStop> TransportCatalogue::MakeNearbyStops(const std::vector<geo::GridIndex::Match>& matches) const {
+    std::vector<NearbyStop> result;
+    result.reserve(matches.size());
+
+    for (const auto& match : matches)
+        result.push_back({frozen_stops_[match.id], match.distance});
+
+    return result;
+}
+
 }  // namespace catalogue 
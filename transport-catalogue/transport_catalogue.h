@@ -10,6 +10,8 @@
 #include <unordered_map>
 
 #include "domain.h"
+#include "spatial_index.h"
+#include "trigram_index.h"
 
 namespace catalogue {
 
@@ -22,12 +24,33 @@ public:  // Constructors
 
 public:  // Methods
     void AddStop(Stop stop);
+    // Автобус с тем же номером заменяет прежний
     void AddBus(Bus bus);
+    // Повторное расстояние между теми же остановками заменяет прежнее
     void AddDistance(std::string_view stop_from, std::string_view stop_to, int distance);
 
+    /* INCREMENTAL UPDATES */
+
+    // Удалённые объекты остаются в хранилищах до Compact(). false - объекта нет в каталоге
+    bool RemoveBus(std::string_view bus_name);
+    // Бросает std::invalid_argument, если через остановку проходят автобусы
+    bool RemoveStop(std::string_view stop_name);
+
+    // Копия каталога без удалённых объектов, не замороженная. Посчитанная статистика автобусов переносится
+    // в копию, поэтому её заморозка пересчитывает статистику только изменённых с тех пор маршрутов
+    [[nodiscard]] TransportCatalogue Compact() const;
+
+    // Строит индексы для поиска по уже загруженным данным. Любое изменение снимает заморозку.
+    // Статистика пересчитывается только для автобусов, маршрут или расстояния которых изменились
+    void Freeze();
+    [[nodiscard]] bool IsFrozen() const;
+
     [[nodiscard]] std::optional<BusStatistics> GetBusStatistics(std::string_view bus_number) const;
     [[nodiscard]] std::unique_ptr<std::set<std::string_view>> GetBusStop(std::string_view stop_name) const;
 
+    // Дорожное расстояние между соседними остановками: если "от -> до" не задано, используется "до -> от"
+    [[nodiscard]] int GetDistance(std::string_view stop_from, std::string_view stop_to) const;
+
     /* METHODS FOR MAP IMAGE RENDERING */
 
     [[nodiscard]] const geo::Coordinates& GetMinStopCoordinates() const;
@@ -37,6 +60,45 @@ public:  // Methods
     [[nodiscard]] BusStopsStorage GetFinalStops(std::string_view bus_name) const;
     [[nodiscard]] BusStopsStorage GetRouteInfo(std::string_view bus_name, bool include_backward_way = true) const;
     [[nodiscard]] StopsStorage GetAllStopsFromRoutes() const;
+    [[nodiscard]] std::shared_ptr<Stop> GetStop(std::string_view stop_name) const;
+    [[nodiscard]] std::shared_ptr<Bus> GetBus(std::string_view bus_name) const;
+
+    // Вызывает func(stop_from, stop_to, distance) для каждого заданного расстояния
+    template <typename Func>
+    void ForEachDistance(Func func) const;
+
+    /* SPATIAL QUERIES: REQUIRE FREEZE */
+
+    // Остановки не дальше radius метров от center, по возрастанию расстояния
+    [[nodiscard]] std::vector<NearbyStop> FindStopsInRadius(const geo::Coordinates& center, double radius) const;
+    // count ближайших к center остановок по возрастанию расстояния
+    [[nodiscard]] std::vector<NearbyStop> FindNearestStops(const geo::Coordinates& center, size_t count) const;
+
+    /* BUS STATISTICS RANKING: REQUIRES FREEZE */
+
+    // count автобусов с наибольшим значением field, по убыванию; при равенстве - по алфавиту
+    [[nodiscard]] std::vector<BusStatistics> GetTopBuses(BusStatisticsField field, size_t count) const;
+    // Автобусы со значением field в отрезке [min_value, max_value], по возрастанию; при равенстве - по алфавиту
+    [[nodiscard]] std::vector<BusStatistics> GetBusesInRange(BusStatisticsField field, double min_value,
+                                                             double max_value) const;
+
+    /* CONNECTIONS: REQUIRE FREEZE */
+
+    // Автобусы по алфавиту, идущие от from до to без пересадок; std::nullopt, если остановки нет
+    [[nodiscard]] std::optional<std::vector<BusConnection>> FindConnections(std::string_view from,
+                                                                             std::string_view to) const;
+
+    /* NAME SEARCH: REQUIRES FREEZE */
+
+    // Все остановки в алфавитном порядке
+    [[nodiscard]] const std::vector<std::shared_ptr<Stop>>& GetSortedStops() const;
+
+    // Первые в алфавитном порядке limit названий, начинающихся с prefix
+    [[nodiscard]] std::vector<std::string_view> FindStopsByPrefix(std::string_view prefix, size_t limit) const;
+    [[nodiscard]] std::vector<std::string_view> FindBusesByPrefix(std::string_view prefix, size_t limit) const;
+    // Не более limit остановок с названием, похожим на name, по убыванию похожести; терпит опечатки
+    [[nodiscard]] std::vector<SimilarStop> FindSimilarStops(std::string_view name, size_t limit,
+                                                            double min_similarity = 0.) const;
 
 private:  // Types
     struct PointStopsHash {
@@ -49,11 +111,19 @@ private:  // Types
     };
 
 private:  // Methods
+    [[nodiscard]] BusStatistics ComputeBusStatistics(const std::shared_ptr<Bus>& bus_info) const;
     [[nodiscard]] int AllRouteLen(const std::shared_ptr<Bus>& bus_info) const;
     [[nodiscard]] double GeoLenCal(const std::shared_ptr<Bus>& bus_info) const;
 
     void UpdateMinMaxStopCoordinates(const geo::Coordinates& coordinates);
 
+    // Сбрасывает посчитанную статистику автобусов, проходящих через остановку
+    void InvalidateBusStatistics(std::string_view stop_name);
+    [[nodiscard]] bool IsLiveStop(const std::shared_ptr<Stop>& stop) const;
+
+    void CheckFrozen() const;
+    [[nodiscard]] std::vector<NearbyStop> MakeNearbyStops(const std::vector<geo::GridIndex::Match>& matches) const;
+
 private:  // Fields
     std::deque<Stop> stops_storage_;
     std::unordered_map<std::string_view, std::shared_ptr<Stop>> stops_;
@@ -71,6 +141,56 @@ private:  // Fields
 // Мы используем неупорядоченные контейнеры для более быстрого поиска в запросах.
     // Нумерованный список нужен только для рендеринга изображения
     std::set<std::string_view> ordered_bus_list_;
+
+    // Удалённые объекты в хранилищах; после удаления автобуса границы координат пересчитываются при заморозке
+    size_t tombstone_count_{0u};
+    bool coordinates_outdated_{false};
+
+    // Статистика, посчитанная при прошлых заморозках. Ключ - номер автобуса, запись удаляется
+    // при изменении его маршрута или расстояний между его остановками
+    std::unordered_map<std::string_view, BusStatistics> bus_statistics_cache_;
+
+    // Индексы, построенные при заморозке. Номер остановки в индексах - её номер в frozen_stops_
+    bool is_frozen_{false};
+    std::vector<std::shared_ptr<Stop>> frozen_stops_;  //> В алфавитном порядке
+    std::vector<std::string_view> frozen_stop_names_;  //> Названия frozen_stops_ подряд для двоичного поиска
+    std::vector<std::string_view> frozen_bus_names_;   //> В алфавитном порядке
+    geo::GridIndex stops_index_;
+    text::TrigramIndex stop_names_index_;
+
+    // Номер автобуса - его номер в frozen_bus_names_. Автобусы остановки хранятся битовой маской
+    // из bus_mask_words_ слов, маски всех остановок лежат подряд в stop_bus_masks_
+    std::unordered_map<std::string_view, uint32_t> frozen_stop_ids_;
+    std::vector<std::shared_ptr<Bus>> frozen_buses_;
+    size_t bus_mask_words_{0u};
+    std::vector<uint64_t> stop_bus_masks_;
+
+    // Позиции остановки на маршрутах в прямом направлении. Записи остановки s - [stop_route_offsets_[s],
+    // stop_route_offsets_[s + 1]) в stop_routes_ по возрастанию номера автобуса, их позиции по возрастанию
+    // лежат подряд в stop_route_positions_
+    struct StopRoute {
+        uint32_t bus_id{0u};
+        uint32_t first_position{0u};
+        uint32_t position_count{0u};
+    };
+    std::vector<uint32_t> stop_route_offsets_;
+    std::vector<StopRoute> stop_routes_;
+    std::vector<uint32_t> stop_route_positions_;
+
+    // Статистика автобусов в порядке frozen_bus_names_ и номера автобусов, отсортированные по каждому полю
+    std::vector<BusStatistics> frozen_bus_statistics_;
+    std::vector<uint8_t> frozen_bus_statistics_missing_;  //> 1 - не хватило расстояний, считается при запросе
+    std::vector<std::vector<uint32_t>> bus_statistics_indexes_;  //> Индекс поля - BusStatisticsField
 };
 
+template <typename Func>
+void TransportCatalogue::ForEachDistance(Func func) const {
+    for (const auto& [stops, distance] : distances_between_stops_) {
+        // Расстояния до удалённых остановок хранятся до Compact()
+        if (tombstone_count_ > 0u && (!IsLiveStop(stops.first) || !IsLiveStop(stops.second)))
+            continue;
+        func(*stops.first, *stops.second, distance);
+    }
+}
+
 }  // namespace catalogue 
@@ -0,0 +1,316 @@
+#include "transport_router.h"
+
+#include <algorithm>
+#include <tuple>
+
+
+#include "log_duration.h"
+#include "parallel.h"
+
+namespace routing {
+
+namespace {
+
+// Вызывает func(bus_name, stops) для каждого направления каждого маршрута
+template <typename Func>
+void ForEachRouteDirection(const catalogue::TransportCatalogue& catalogue, Func func) {
+    for (std::string_view bus_name : catalogue.GetOrderedBusList()) {
+        const auto bus = catalogue.GetBus(bus_name);
+        if (bus->stop_names.empty())
+            continue;
+
+        func(std::string_view(bus->number), bus->stop_names);
+        if (bus->type == catalogue::RouteType::TWO_DIRECTIONAL)
+            func(std::string_view(bus->number), std::vector<std::string_view>(bus->stop_names.rbegin(),
+                                                                              bus->stop_names.rend()));
+    }
+}
+
+}  // namespace
+
+TransportRouter::TransportRouter(const catalogue::TransportCatalogue& catalogue, RoutingSettings settings)
+    : catalogue_(catalogue), settings_(settings) {}
+
+std::optional<RouteInfo> TransportRouter::BuildRoute(std::string_view stop_from, std::string_view stop_to) const {
+    // Маршрут от остановки до неё самой пуст, даже если через неё не проходят автобусы
+    if (stop_from == stop_to)
+        return catalogue_.GetStop(stop_from) ? std::make_optional<RouteInfo>() : std::nullopt;
+
+    // Граф строится при первом запросе и замеряется отдельно
+    const auto& data = GetData();
+    LOG_DURATION("Route query");
+
+    const auto from = data.stop_vertices.find(stop_from);
+    const auto to = data.stop_vertices.find(stop_to);
+    if (from == data.stop_vertices.end() || to == data.stop_vertices.end())
+        return std::nullopt;
+
+    const graph::VertexId source = from->second;
+    const graph::VertexId target = to->second;
+
+    if (data.hierarchy) {
+        const auto query = data.queries.Acquire(*data.hierarchy);
+        if (const auto total_time = query->Run(source, target))
+            return MakeRouteInfo(*total_time, query->BuildPath());
+        return std::nullopt;
+    }
+
+    const auto search = data.searches.Acquire(data.graph);
+    search->Run(source, target);
+    if (!search->IsReached(target))
+        return std::nullopt;
+
+    return MakeRouteInfo(search->GetDistance(target), search->BuildPath(target));
+}
+
+TravelTimeMatrix TransportRouter::BuildTravelTimeMatrix(const std::vector<std::string_view>& sources,
+                                                        const std::vector<std::string_view>& targets) const {
+    LOG_DURATION("Travel time matrix");
+
+    const auto& data = GetData();
+
+    TravelTimeMatrix matrix;
+    matrix.sources_count = sources.size();
+    matrix.targets_count = targets.size();
+    matrix.times.resize(sources.size() * targets.size());
+
+    auto find_vertex = [&data](std::string_view stop) -> std::optional<graph::VertexId> {
+        if (const auto position = data.stop_vertices.find(stop); position != data.stop_vertices.end())
+            return position->second;
+        return std::nullopt;
+    };
+
+    std::vector<std::optional<graph::VertexId>> target_vertices;
+    std::vector<graph::VertexId> search_targets;
+    for (std::string_view target : targets) {
+        target_vertices.emplace_back(find_vertex(target));
+        if (target_vertices.back())
+            search_targets.emplace_back(*target_vertices.back());
+    }
+
+    // Строки независимы: каждая считается одним поиском, который останавливается на последней цели
+    auto fill_row = [&](size_t row, size_t /*thread_id*/) {
+        auto* cells = matrix.times.data() + row * targets.size();
+
+        const auto source = find_vertex(sources[row]);
+        if (!source) {
+            // Через остановку не проходят автобусы, но путь до неё самой всё равно существует
+            if (catalogue_.GetStop(sources[row])) {
+                for (size_t column = 0; column < targets.size(); ++column) {
+                    if (targets[column] == sources[row])
+                        cells[column] = 0.;
+                }
+            }
+            return;
+        }
+        if (search_targets.empty())
+            return;
+
+        const auto search = data.searches.Acquire(data.graph);
+        search->RunToTargets(*source, search_targets);
+
+        for (size_t column = 0; column < targets.size(); ++column) {
+            if (target_vertices[column] && search->IsReached(*target_vertices[column]))
+                cells[column] = search->GetDistance(*target_vertices[column]);
+        }
+    };
+
+    parallel::ForEachIndex(sources.size(), parallel::GetDefaultThreadCount(), fill_row);
+    return matrix;
+}
+
+std::optional<std::vector<ReachableStop>> TransportRouter::FindReachableStops(std::string_view stop_from,
+                                                                              double time_budget) const {
+    const auto& data = GetData();
+
+    const auto from = data.stop_vertices.find(stop_from);
+    if (from == data.stop_vertices.end()) {
+        // Через остановку не проходят автобусы: достижима только она сама
+        if (catalogue_.GetStop(stop_from))
+            return std::vector<ReachableStop>{{catalogue_.GetStop(stop_from)->name, 0.}};
+        return std::nullopt;
+    }
+
+    // Поиск останавливается на первой вершине дальше бюджета, поэтому затрагивает только ближнюю часть графа
+    const auto search = data.searches.Acquire(data.graph);
+    search->Run(from->second, std::nullopt, time_budget);
+
+    std::vector<ReachableStop> result;
+    for (graph::VertexId vertex : search->GetSettled()) {
+        if (!data.vertex_stops[vertex].empty())
+            result.push_back({data.vertex_stops[vertex], search->GetDistance(vertex)});
+    }
+
+    // Вершины извлекаются по возрастанию времени; при равном времени порядок задаёт название
+    std::stable_sort(result.begin(), result.end(), [](const ReachableStop& lhs, const ReachableStop& rhs) {
+        return std::tie(lhs.time, lhs.stop_name) < std::tie(rhs.time, rhs.stop_name);
+    });
+
+    return result;
+}
+
+std::vector<std::optional<std::vector<ReachableStop>>> TransportRouter::FindReachableStops(
+    const std::vector<std::string_view>& stops_from, double time_budget) const {
+    LOG_DURATION("Multi-source isochrones");
+
+    // Граф строится до запуска потоков, чтобы они не ждали друг друга в std::call_once
+    (void)GetData();
+
+    std::vector<std::optional<std::vector<ReachableStop>>> result(stops_from.size());
+    parallel::ForEachIndex(stops_from.size(), parallel::GetDefaultThreadCount(), [&](size_t id, size_t) {
+        result[id] = FindReachableStops(stops_from[id], time_budget);
+    });
+
+    return result;
+}
+
+const RoutingSettings& TransportRouter::GetSettings() const {
+    return settings_;
+}
+
+const graph::CsrGraph& TransportRouter::GetGraph() const {
+    return GetData().graph;
+}
+
+const TransportRouter::RoutingData& TransportRouter::GetData() const {
+    std::call_once(data_flag_, [this] { data_ = BuildRoutingData(); });
+    return *data_;
+}
+
+std::unique_ptr<TransportRouter::RoutingData> TransportRouter::BuildRoutingData() const {
+    LOG_DURATION("Routing graph build");
+
+    auto data = std::make_unique<RoutingData>();
+
+    if (settings_.use_contraction_hierarchies) {
+        BuildRouteExpandedGraph(*data);
+    } else {
+        BuildDenseGraph(*data);
+    }
+
+    data->vertex_stops.resize(data->graph.GetVertexCount());
+    for (const auto& [stop_name, vertex] : data->stop_vertices)
+        data->vertex_stops[vertex] = stop_name;
+
+    if (settings_.use_contraction_hierarchies) {
+        LOG_DURATION("Contraction hierarchy build");
+        data->hierarchy = std::make_unique<graph::ContractionHierarchy>(data->graph);
+    }
+    return data;
+}
+
+void TransportRouter::BuildDenseGraph(RoutingData& data) const {
+    std::vector<graph::Edge> edges;
+
+    // Шаг 1. У каждой остановки вершина ожидания 2 * id и вершина посадки 2 * id + 1
+    for (const auto& [stop_name, _] : catalogue_.GetAllStopsFromRoutes()) {
+        const auto wait_vertex = static_cast<graph::VertexId>(2 * data.stop_vertices.size());
+        data.stop_vertices.emplace(stop_name, wait_vertex);
+
+        edges.push_back({wait_vertex, wait_vertex + 1, settings_.bus_wait_time});
+        data.edges_info.push_back({EdgeKind::Wait, stop_name, 0});
+    }
+
+    // Шаг 2. Рёбра поездки от каждой остановки маршрута до каждой следующей
+    const double metres_per_minute = settings_.bus_velocity * 1000. / 60.;
+    if (metres_per_minute > 0.) {
+        ForEachRouteDirection(catalogue_, [&](std::string_view bus_name, const std::vector<std::string_view>& stops) {
+            // Префиксные суммы расстояний: расстояние между i и j - разность сумм
+            std::vector<double> prefix_distances{0.};
+            for (size_t id = 0; id + 1 < stops.size(); ++id)
+                prefix_distances.emplace_back(prefix_distances.back() + catalogue_.GetDistance(stops[id], stops[id + 1]));
+
+            std::vector<graph::VertexId> wait_vertices;
+            for (std::string_view stop : stops)
+                wait_vertices.emplace_back(data.stop_vertices.at(stop));
+
+            for (size_t from = 0; from < stops.size(); ++from) {
+                for (size_t to = from + 1; to < stops.size(); ++to) {
+                    const double time = (prefix_distances[to] - prefix_distances[from]) / metres_per_minute;
+                    edges.push_back({wait_vertices[from] + 1, wait_vertices[to], time});
+                    data.edges_info.push_back({EdgeKind::Ride, bus_name, static_cast<int>(to - from)});
+                }
+            }
+        });
+    }
+
+    data.graph = graph::CsrGraph(2 * data.stop_vertices.size(), std::move(edges));
+}
+
+void TransportRouter::BuildRouteExpandedGraph(RoutingData& data) const {
+    std::vector<graph::Edge> edges;
+
+    // Шаг 1. Вершины ожидания остановок
+    for (const auto& [stop_name, _] : catalogue_.GetAllStopsFromRoutes())
+        data.stop_vertices.emplace(stop_name, static_cast<graph::VertexId>(data.stop_vertices.size()));
+
+    // Шаг 2. Вершины остановок маршрутов: посадка с ожиданием, поездка до соседней остановки и выход
+    auto vertex_count = static_cast<graph::VertexId>(data.stop_vertices.size());
+
+    const double metres_per_minute = settings_.bus_velocity * 1000. / 60.;
+    if (metres_per_minute > 0.) {
+        ForEachRouteDirection(catalogue_, [&](std::string_view bus_name, const std::vector<std::string_view>& stops) {
+            const graph::VertexId first = vertex_count;
+            vertex_count += static_cast<graph::VertexId>(stops.size());
+
+            for (size_t id = 0; id < stops.size(); ++id) {
+                const graph::VertexId stop_vertex = data.stop_vertices.at(stops[id]);
+                const auto route_vertex = static_cast<graph::VertexId>(first + id);
+
+                if (id + 1 < stops.size()) {
+                    edges.push_back({stop_vertex, route_vertex, settings_.bus_wait_time});
+                    data.edges_info.push_back({EdgeKind::Wait, stops[id], 0});
+
+                    const double time = catalogue_.GetDistance(stops[id], stops[id + 1]) / metres_per_minute;
+                    edges.push_back({route_vertex, route_vertex + 1, time});
+                    data.edges_info.push_back({EdgeKind::Ride, bus_name, 1});
+                }
+                if (id > 0) {
+                    edges.push_back({route_vertex, stop_vertex, 0.});
+                    data.edges_info.push_back({EdgeKind::Alight, stops[id], 0});
+                }
+            }
+        });
+    }
+
+    data.graph = graph::CsrGraph(vertex_count, std::move(edges));
+}
+
+RouteInfo TransportRouter::MakeRouteInfo(double total_time, const std::vector<graph::EdgeId>& path) const {
+    const auto& data = GetData();
+
+    RouteInfo result;
+    result.total_time = total_time;
+    result.items.reserve(path.size());
+
+    // Подряд идущие рёбра поездки без выхода из автобуса образуют одну поездку
+    bool is_riding = false;
+
+    for (graph::EdgeId edge_id : path) {
+        const auto& info = data.edges_info[edge_id];
+        const double time = data.graph.GetEdge(edge_id).weight;
+
+        switch (info.kind) {
+            case EdgeKind::Wait:
+                result.items.push_back({RouteItemType::Wait, info.name, 0, time});
+                is_riding = false;
+                break;
+            case EdgeKind::Ride:
+                if (is_riding) {
+                    result.items.back().span_count += info.span_count;
+                    result.items.back().time += time;
+                } else {
+                    result.items.push_back({RouteItemType::Bus, info.name, info.span_count, time});
+                }
+                is_riding = true;
+                break;
+            case EdgeKind::Alight:
+                is_riding = false;
+                break;
+        }
+    }
+
+    return result;
+}
+
+}  // namespace routing
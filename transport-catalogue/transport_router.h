@@ -0,0 +1,176 @@
+#pragma once
+
+/*
+ * Описание: построение маршрутов между остановками.
+ * Каталог превращается в граф: у каждой остановки две вершины - "ожидание" и "посадка".
+ * Ребро ожидания ведёт из первой во вторую и весит bus_wait_time, рёбра поездки ведут из вершины посадки
+ * остановки в вершину ожидания каждой следующей остановки того же маршрута.
+ */
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "contraction_hierarchy.h"
+#include "graph.h"
+#include "transport_catalogue.h"
+
+namespace routing {
+
+struct RoutingSettings {
+    double bus_wait_time{0.};  //> Минуты
+    double bus_velocity{0.};   //> Км/ч
+
+    // Предобработка графа иерархиями сжатия: дольше запуск, но быстрее каждый запрос
+    bool use_contraction_hierarchies{false};
+};
+
+enum class RouteItemType { Wait, Bus };
+
+struct RouteItem {
+    RouteItemType type{RouteItemType::Wait};
+    std::string_view name;  //> Название остановки для ожидания или номер автобуса для поездки
+    int span_count{0};
+    double time{0.};
+};
+
+struct RouteInfo {
+    double total_time{0.};
+    std::vector<RouteItem> items;
+};
+
+// Таблица времени в пути: строка - источник, столбец - цель, std::nullopt - цель недостижима
+struct TravelTimeMatrix {
+    size_t sources_count{0u};
+    size_t targets_count{0u};
+    std::vector<std::optional<double>> times;  //> Построчно
+
+    [[nodiscard]] const std::optional<double>& At(size_t source, size_t target) const {
+        return times[source * targets_count + target];
+    }
+};
+
+// Остановка, до которой можно добраться, и время в пути до неё без ожидания на ней
+struct ReachableStop {
+    std::string_view stop_name;
+    double time{0.};
+};
+
+class TransportRouter {
+public:  // Constructor
+    TransportRouter(const catalogue::TransportCatalogue& catalogue, RoutingSettings settings);
+
+public:  // Methods
+    [[nodiscard]] std::optional<RouteInfo> BuildRoute(std::string_view stop_from, std::string_view stop_to) const;
+
+    // Время в пути между всеми парами источник-цель: по одному дереву кратчайших путей на источник
+    [[nodiscard]] TravelTimeMatrix BuildTravelTimeMatrix(const std::vector<std::string_view>& sources,
+                                                         const std::vector<std::string_view>& targets) const;
+
+    // Остановки, достижимые из stop_from не дольше чем за time_budget минут, по возрастанию времени.
+    // std::nullopt - остановки нет в каталоге
+    [[nodiscard]] std::optional<std::vector<ReachableStop>> FindReachableStops(std::string_view stop_from,
+                                                                               double time_budget) const;
+
+    // То же для нескольких начальных остановок сразу: поиски независимы и выполняются параллельно
+    [[nodiscard]] std::vector<std::optional<std::vector<ReachableStop>>> FindReachableStops(
+        const std::vector<std::string_view>& stops_from, double time_budget) const;
+
+    [[nodiscard]] const RoutingSettings& GetSettings() const;
+
+    // Граф строится при первом обращении, поэтому пакеты без маршрутных запросов не платят за его построение
+    [[nodiscard]] const graph::CsrGraph& GetGraph() const;
+
+private:  // Types
+    enum class EdgeKind {
+        Wait,   //> Ожидание автобуса на остановке
+        Ride,   //> Поездка на span_count остановок
+        Alight  //> Выход из автобуса в графе с вершинами маршрутов, элемента ответа не образует
+    };
+
+    struct EdgeInfo {
+        EdgeKind kind{EdgeKind::Wait};
+        std::string_view name;  //> Остановка для ожидания, автобус для поездки
+        int span_count{0};
+    };
+
+    /*
+     * Состояния поиска, переиспользуемые между запросами. Взятое состояние принадлежит одному потоку,
+     * пока жив Lease, затем возвращается в пул. Пул принадлежит графу маршрутизатора и освобождается вместе
+     * с ним, поэтому состояние никогда не переживает граф, для которого создано
+     */
+    template <typename State>
+    class StatePool {
+    public:  // Types
+        struct Release {
+            StatePool* pool{nullptr};
+            void operator()(State* state) const;
+        };
+        using Lease = std::unique_ptr<State, Release>;
+
+    public:  // Methods
+        // source - граф или иерархия, для которых создаётся новое состояние, если свободных нет
+        template <typename Source>
+        [[nodiscard]] Lease Acquire(const Source& source);
+
+    private:  // Fields
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<State>> free_states_;
+    };
+
+    struct RoutingData {
+        graph::CsrGraph graph;
+        std::vector<EdgeInfo> edges_info;
+        std::unordered_map<std::string_view, graph::VertexId> stop_vertices;  //> Вершина ожидания остановки
+        std::vector<std::string_view> vertex_stops;  //> Остановка вершины ожидания, пусто для прочих вершин
+        std::unique_ptr<graph::ContractionHierarchy> hierarchy;  //> Только при use_contraction_hierarchies
+
+        mutable StatePool<graph::DijkstraSearch> searches;
+        mutable StatePool<graph::ContractionHierarchyQuery> queries;
+    };
+
+private:  // Methods
+    [[nodiscard]] const RoutingData& GetData() const;
+    [[nodiscard]] std::unique_ptr<RoutingData> BuildRoutingData() const;
+
+    // Рёбра поездки между всеми парами остановок маршрута: короткий путь для алгоритма Дейкстры
+    void BuildDenseGraph(RoutingData& data) const;
+    // Вершина на каждую остановку каждого маршрута: разреженный граф, который хорошо сжимается
+    void BuildRouteExpandedGraph(RoutingData& data) const;
+
+    [[nodiscard]] RouteInfo MakeRouteInfo(double total_time, const std::vector<graph::EdgeId>& path) const;
+
+private:  // Fields
+    const catalogue::TransportCatalogue& catalogue_;
+    RoutingSettings settings_;
+
+    mutable std::once_flag data_flag_;
+    mutable std::unique_ptr<RoutingData> data_;
+};
+
+template <typename State>
+void TransportRouter::StatePool<State>::Release::operator()(State* state) const {
+    std::lock_guard guard(pool->mutex_);
+    pool->free_states_.emplace_back(state);
+}
+
+template <typename State>
+template <typename Source>
+typename TransportRouter::StatePool<State>::Lease TransportRouter::StatePool<State>::Acquire(const Source& source) {
+    std::unique_ptr<State> state;
+    {
+        std::lock_guard guard(mutex_);
+        if (!free_states_.empty()) {
+            state = std::move(free_states_.back());
+            free_states_.pop_back();
+        }
+    }
+    if (!state)
+        state = std::make_unique<State>(source);
+    return Lease(state.release(), Release{this});
+}
+
+}  // namespace routing
@@ -0,0 +1,165 @@
+#include "trigram_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+namespace text {
+
+namespace {
+
+// Граница слова: дополняет название, чтобы начало и конец давали собственные триграммы
+constexpr char32_t kBoundary = U' ';
+
+// Декодирует UTF-8. Некорректный байт считается отдельным символом
+std::u32string Decode(std::string_view text) {
+    std::u32string result;
+    result.reserve(text.size());
+
+    for (size_t i = 0; i < text.size();) {
+        const auto lead = static_cast<unsigned char>(text[i]);
+        size_t length = 1;
+        char32_t symbol = lead;
+
+        if (lead >= 0xC0u && lead < 0xE0u) {
+            length = 2;
+            symbol = lead & 0x1Fu;
+        } else if (lead >= 0xE0u && lead < 0xF0u) {
+            length = 3;
+            symbol = lead & 0x0Fu;
+        } else if (lead >= 0xF0u && lead < 0xF8u) {
+            length = 4;
+            symbol = lead & 0x07u;
+        }
+
+        if (length > 1 && i + length <= text.size()) {
+            for (size_t j = 1; j < length; ++j)
+                symbol = (symbol << 6) | (static_cast<unsigned char>(text[i + j]) & 0x3Fu);
+        } else {
+            length = 1;
+            symbol = lead;
+        }
+
+        result.push_back(symbol);
+        i += length;
+    }
+
+    return result;
+}
+
+// Регистр и "ё" не различаются; пробелы, дефисы и прочие знаки сводятся к одной границе слова
+char32_t Normalize(char32_t symbol) {
+    if (symbol >= U'A' && symbol <= U'Z')
+        return symbol - U'A' + U'a';
+    if (symbol >= U'А' && symbol <= U'Я')
+        return symbol - U'А' + U'а';
+    if (symbol == U'Ё' || symbol == U'ё')
+        return U'е';
+    if ((symbol >= U'a' && symbol <= U'z') || (symbol >= U'0' && symbol <= U'9') || symbol > 0x7Fu)
+        return symbol;
+    return kBoundary;
+}
+
+// Различные триграммы названия; символ занимает 21 бит, триграмма - 63 бита
+std::vector<uint64_t> ExtractTrigrams(std::string_view name) {
+    std::u32string symbols(2, kBoundary);
+    for (char32_t symbol : Decode(name)) {
+        symbol = Normalize(symbol);
+        if (symbol != kBoundary || symbols.back() != kBoundary)
+            symbols.push_back(symbol);
+    }
+    if (symbols.back() != kBoundary)
+        symbols.push_back(kBoundary);
+
+    std::vector<uint64_t> trigrams;
+    for (size_t i = 0; i + 2 < symbols.size(); ++i) {
+        trigrams.push_back((static_cast<uint64_t>(symbols[i]) << 42) | (static_cast<uint64_t>(symbols[i + 1]) << 21) |
+                           static_cast<uint64_t>(symbols[i + 2]));
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+}  // namespace
+
+TrigramIndex::TrigramIndex(const std::vector<std::string_view>& names) {
+    std::vector<std::vector<uint64_t>> name_trigrams;
+    name_trigrams.reserve(names.size());
+    trigram_counts_.reserve(names.size());
+
+    // Шаг 1. Номера списков и их длины
+    std::vector<uint32_t> list_sizes;
+    for (std::string_view name : names) {
+        auto trigrams = ExtractTrigrams(name);
+        for (uint64_t trigram : trigrams) {
+            const auto [position, inserted] =
+                trigram_lists_.emplace(trigram, static_cast<uint32_t>(list_sizes.size()));
+            if (inserted)
+                list_sizes.push_back(0u);
+            ++list_sizes[position->second];
+        }
+        trigram_counts_.push_back(static_cast<uint32_t>(trigrams.size()));
+        name_trigrams.emplace_back(std::move(trigrams));
+    }
+
+    // Шаг 2. Списки подряд в одном массиве; номера названий добавляются по возрастанию
+    list_offsets_.assign(list_sizes.size() + 1, 0u);
+    for (size_t list = 0; list < list_sizes.size(); ++list)
+        list_offsets_[list + 1] = list_offsets_[list] + list_sizes[list];
+
+    postings_.resize(list_offsets_.back());
+    std::vector<uint32_t> fill(list_offsets_.begin(), std::prev(list_offsets_.end()));
+    for (uint32_t id = 0; id < name_trigrams.size(); ++id) {
+        for (uint64_t trigram : name_trigrams[id])
+            postings_[fill[trigram_lists_.at(trigram)]++] = id;
+    }
+}
+
+size_t TrigramIndex::GetSize() const {
+    return trigram_counts_.size();
+}
+
+std::vector<TrigramIndex::Match> TrigramIndex::FindSimilar(std::string_view query, size_t limit,
+                                                           double min_similarity) const {
+    const auto query_trigrams = ExtractTrigrams(query);
+
+    // Шаг 1. Число общих с запросом триграмм для каждого кандидата: один проход по спискам запроса
+    std::vector<uint32_t> common(trigram_counts_.size(), 0u);
+    std::vector<uint32_t> candidates;
+    for (uint64_t trigram : query_trigrams) {
+        const auto list = trigram_lists_.find(trigram);
+        if (list == trigram_lists_.end())
+            continue;
+
+        for (uint32_t i = list_offsets_[list->second]; i < list_offsets_[list->second + 1]; ++i) {
+            if (common[postings_[i]]++ == 0u)
+                candidates.push_back(postings_[i]);
+        }
+    }
+
+    // Шаг 2. Коэффициент Дайса: 2 * |общие| / (|триграммы запроса| + |триграммы названия|)
+    std::vector<Match> result;
+    result.reserve(candidates.size());
+    for (uint32_t id : candidates) {
+        const double similarity =
+            2. * common[id] / static_cast<double>(query_trigrams.size() + trigram_counts_[id]);
+        if (similarity >= min_similarity)
+            result.push_back({id, similarity});
+    }
+
+    const auto better = [](const Match& lhs, const Match& rhs) {
+        return lhs.similarity > rhs.similarity || (lhs.similarity == rhs.similarity && lhs.id < rhs.id);
+    };
+    if (result.size() > limit) {
+        std::partial_sort(result.begin(), result.begin() + static_cast<std::ptrdiff_t>(limit), result.end(), better);
+        result.resize(limit);
+    } else {
+        std::sort(result.begin(), result.end(), better);
+    }
+
+    return result;
+}
+
+}  // namespace text
@@ -0,0 +1,42 @@
+#pragma once
+
+/*
+ * Описание: индекс триграмм для нечёткого поиска по названиям.
+ * Название разбивается на тройки подряд идущих символов (с учётом границ слова), для каждой триграммы
+ * хранится отсортированный список номеров названий. Похожесть - коэффициент Дайса по множествам триграмм,
+ * поэтому опечатка портит лишь несколько триграмм и название всё равно находится.
+ */
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace text {
+
+class TrigramIndex {
+public:  // Types
+    struct Match {
+        uint32_t id{0u};         //> Номер названия в исходном массиве
+        double similarity{0.};   //> От 0 до 1; 1 - совпадающие множества триграмм
+    };
+
+public:  // Constructors
+    TrigramIndex() = default;
+    explicit TrigramIndex(const std::vector<std::string_view>& names);
+
+public:  // Methods
+    [[nodiscard]] size_t GetSize() const;
+
+    // Не более limit названий с похожестью не ниже min_similarity: по убыванию похожести, затем по номеру
+    [[nodiscard]] std::vector<Match> FindSimilar(std::string_view query, size_t limit,
+                                                 double min_similarity = 0.) const;
+
+private:  // Fields
+    std::unordered_map<uint64_t, uint32_t> trigram_lists_;  //> Триграмма -> номер её списка
+    std::vector<uint32_t> list_offsets_;  //> Список: [list_offsets_[list], list_offsets_[list + 1])
+    std::vector<uint32_t> postings_;      //> Номера названий, в каждом списке по возрастанию
+    std::vector<uint32_t> trigram_counts_;  //> Число различных триграмм названия
+};
+
+}  // namespace text